@@ -0,0 +1,201 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "OffAxisTest.h"
+#include "OffAxisFramePacer.h"
+#include "OffAxisLatencyTracker.h"
+
+#include "Framework/Application/SlateApplication.h"
+#include "Rendering/SlateRenderer.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Pacing: wait (ms)"), STAT_OffAxisPacingWait, STATGROUP_OffAxis);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Pacing: recovered sample age (ms)"), STAT_OffAxisPacingRecovered, STATGROUP_OffAxis);
+
+static TAutoConsoleVariable<int32> CVarOffAxisPacing(
+	TEXT("r.OffAxis.Pacing"),
+	0,
+	TEXT("Whether the off-axis view setup waits for the next tracker sample.\n")
+	TEXT(" 0: off (default)\n")
+	TEXT(" 1: wait for the predicted next sample if it still arrives in time for the next vsync"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisPacingTrackerHz(
+	TEXT("r.OffAxis.Pacing.TrackerHz"),
+	0.0f,
+	TEXT("Tracker sample rate in Hz. 0: estimate from the arrival times of the samples (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisPacingMaxWaitMs(
+	TEXT("r.OffAxis.Pacing.MaxWaitMs"),
+	4.0f,
+	TEXT("Longest time in milliseconds the game thread waits for a tracker sample."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisPacingFrameBudgetMs(
+	TEXT("r.OffAxis.Pacing.FrameBudgetMs"),
+	10.0f,
+	TEXT("Time in milliseconds the frame needs between the view setup and present. Waits that would cut into it are skipped."),
+	ECVF_Default);
+
+/** Weight of a new interval in the exponential moving averages of the tracker and present periods. */
+static const double PeriodSmoothing = 0.1;
+
+static int64 SmoothPeriod(int64 CurrentPeriod, int64 Interval)
+{
+	return CurrentPeriod == 0 ? Interval : CurrentPeriod + (int64)((Interval - CurrentPeriod) * PeriodSmoothing);
+}
+
+FOffAxisFramePacer& FOffAxisFramePacer::Get()
+{
+	static FOffAxisFramePacer Pacer;
+	return Pacer;
+}
+
+FOffAxisFramePacer::FOffAxisFramePacer()
+	: NumFrames(0)
+	, NumWaits(0)
+	, NumMissedSamples(0)
+	, TotalWaitMs(0.0)
+	, TotalRecoveredMs(0.0)
+	, bPresentHookRegistered(false)
+{
+}
+
+void FOffAxisFramePacer::OnTrackerSample(uint64 SampleCycles)
+{
+	LastSampleOnGameThread.Set(IsInGameThread() ? 1 : 0);
+
+	const int64 PreviousCycles = LastSampleCycles.Set((int64)SampleCycles);
+	const int64 Interval = (int64)SampleCycles - PreviousCycles;
+
+	// Ignore the first sample and gaps where the tracker was lost.
+	if (PreviousCycles != 0 && Interval > 0 && FPlatformTime::ToSeconds64(Interval) < 0.1)
+	{
+		SamplePeriodCycles.Set(SmoothPeriod(SamplePeriodCycles.GetValue(), Interval));
+	}
+}
+
+void FOffAxisFramePacer::RegisterPresentHook()
+{
+	if (bPresentHookRegistered || !FSlateApplication::IsInitialized())
+	{
+		return;
+	}
+
+	FSlateRenderer* Renderer = FSlateApplication::Get().GetRenderer();
+	if (Renderer)
+	{
+		Renderer->OnBackBufferReadyToPresent().AddRaw(this, &FOffAxisFramePacer::OnBackBufferReadyToPresent);
+		bPresentHookRegistered = true;
+	}
+}
+
+void FOffAxisFramePacer::OnBackBufferReadyToPresent(SWindow& Window, const FTexture2DRHIRef& BackBuffer)
+{
+	const int64 Now = (int64)FPlatformTime::Cycles64();
+	const int64 PreviousCycles = LastPresentCycles.Set(Now);
+	const int64 Interval = Now - PreviousCycles;
+
+	if (PreviousCycles != 0 && Interval > 0 && FPlatformTime::ToSeconds64(Interval) < 0.1)
+	{
+		PresentPeriodCycles.Set(SmoothPeriod(PresentPeriodCycles.GetValue(), Interval));
+	}
+}
+
+void FOffAxisFramePacer::WaitForFreshSample()
+{
+	check(IsInGameThread());
+
+	// Nothing can hand in a sample while the game thread itself waits for it.
+	if (CVarOffAxisPacing.GetValueOnGameThread() == 0 || LastSampleOnGameThread.GetValue() != 0)
+	{
+		return;
+	}
+
+	RegisterPresentHook();
+
+	const int64 SampleCycles = LastSampleCycles.GetValue();
+	const float TrackerHz = CVarOffAxisPacingTrackerHz.GetValueOnGameThread();
+	const int64 SamplePeriod = TrackerHz > 0.0f ? (int64)(1.0 / (TrackerHz * FPlatformTime::GetSecondsPerCycle64())) : SamplePeriodCycles.GetValue();
+	const int64 PresentCycles = LastPresentCycles.GetValue();
+	const int64 PresentPeriod = PresentPeriodCycles.GetValue();
+
+	if (SampleCycles == 0 || SamplePeriod <= 0 || PresentCycles == 0 || PresentPeriod <= 0)
+	{
+		return;
+	}
+
+	NumFrames++;
+
+	const int64 Now = (int64)FPlatformTime::Cycles64();
+
+	// Predict the next arrival and the next vsync after now.
+	const int64 NextSample = SampleCycles + (FMath::Max<int64>(Now - SampleCycles, 0) / SamplePeriod + 1) * SamplePeriod;
+	const int64 NextVsync = PresentCycles + (FMath::Max<int64>(Now - PresentCycles, 0) / PresentPeriod + 1) * PresentPeriod;
+
+	const double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+	const int64 MaxWait = (int64)(CVarOffAxisPacingMaxWaitMs.GetValueOnGameThread() / (1000.0 * SecondsPerCycle));
+	const int64 FrameBudget = (int64)(CVarOffAxisPacingFrameBudgetMs.GetValueOnGameThread() / (1000.0 * SecondsPerCycle));
+
+	if (NextSample - Now > MaxWait || NextSample + FrameBudget > NextVsync)
+	{
+		SET_FLOAT_STAT(STAT_OffAxisPacingWait, 0.0f);
+		SET_FLOAT_STAT(STAT_OffAxisPacingRecovered, 0.0f);
+		return;
+	}
+
+	// Allow for a quarter period of jitter in the arrival before giving up on the sample.
+	const int64 WaitUntil = FMath::Min(NextSample + SamplePeriod / 4, Now + MaxWait);
+	while (LastSampleCycles.GetValue() == SampleCycles && (int64)FPlatformTime::Cycles64() < WaitUntil)
+	{
+		FPlatformProcess::SleepNoStats(0.0f);
+	}
+
+	const int64 FreshSampleCycles = LastSampleCycles.GetValue();
+	const float WaitMs = (float)(((int64)FPlatformTime::Cycles64() - Now) * SecondsPerCycle * 1000.0);
+	const float RecoveredMs = FreshSampleCycles != SampleCycles ? (float)((FreshSampleCycles - SampleCycles) * SecondsPerCycle * 1000.0) : 0.0f;
+
+	NumWaits++;
+	TotalWaitMs += WaitMs;
+	TotalRecoveredMs += RecoveredMs;
+	if (FreshSampleCycles == SampleCycles)
+	{
+		NumMissedSamples++;
+	}
+
+	SET_FLOAT_STAT(STAT_OffAxisPacingWait, WaitMs);
+	SET_FLOAT_STAT(STAT_OffAxisPacingRecovered, RecoveredMs);
+}
+
+void FOffAxisFramePacer::LogSummary() const
+{
+	const double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+	const int64 SamplePeriod = SamplePeriodCycles.GetValue();
+	const int64 PresentPeriod = PresentPeriodCycles.GetValue();
+
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis pacing: tracker %.1f Hz, display %.1f Hz"),
+		SamplePeriod > 0 ? 1.0 / (SamplePeriod * SecondsPerCycle) : 0.0,
+		PresentPeriod > 0 ? 1.0 / (PresentPeriod * SecondsPerCycle) : 0.0);
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis pacing: waited in %u of %u frames (%u without a new sample), mean wait %.2f ms, mean recovered sample age %.2f ms per frame"),
+		NumWaits, NumFrames, NumMissedSamples,
+		NumWaits ? TotalWaitMs / NumWaits : 0.0,
+		NumFrames ? TotalRecoveredMs / NumFrames : 0.0);
+}
+
+void FOffAxisFramePacer::Reset()
+{
+	NumFrames = 0;
+	NumWaits = 0;
+	NumMissedSamples = 0;
+	TotalWaitMs = 0.0;
+	TotalRecoveredMs = 0.0;
+}
+
+static FAutoConsoleCommand OffAxisPacingSummaryCmd(
+	TEXT("OffAxis.Pacing.Summary"),
+	TEXT("Logs the estimated tracker and display rates and how much sample age the frame pacing recovered."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisFramePacer::Get().LogSummary(); }));
+
+static FAutoConsoleCommand OffAxisPacingResetCmd(
+	TEXT("OffAxis.Pacing.Reset"),
+	TEXT("Clears the frame pacing statistics."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisFramePacer::Get().Reset(); }));
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "RHI.h"
+
+/**
+ * Delays the off-axis view setup until the next tracker sample has arrived, as long as the frame still makes its vsync.
+ * Tracker sample arrivals and presents are timed to predict both the next sample and the next vsync.
+ */
+class OFFAXISTEST_API FOffAxisFramePacer
+{
+public:
+
+	static FOffAxisFramePacer& Get();
+
+	/**
+	 * Called for every tracker sample as it arrives, from whatever thread the tracker delivers on. Samples delivered on
+	 * the game thread can't arrive while it waits, pacing is skipped for them.
+	 */
+	void OnTrackerSample(uint64 SampleCycles);
+
+	/** Waits on the game thread for the predicted next tracker sample if it arrives early enough for the upcoming vsync. */
+	void WaitForFreshSample();
+
+	/** Logs how often the pacer waited and how much sample age it recovered. Game thread only. */
+	void LogSummary() const;
+
+	void Reset();
+
+private:
+
+	FOffAxisFramePacer();
+
+	void RegisterPresentHook();
+	void OnBackBufferReadyToPresent(class SWindow& Window, const FTexture2DRHIRef& BackBuffer);
+
+	/** Written by the tracker thread. */
+	FThreadSafeCounter64 LastSampleCycles;
+	FThreadSafeCounter64 SamplePeriodCycles;
+	FThreadSafeCounter64 LastSampleOnGameThread;
+
+	/** Written by the render thread. */
+	FThreadSafeCounter64 LastPresentCycles;
+	FThreadSafeCounter64 PresentPeriodCycles;
+
+	/** Game thread statistics. */
+	uint32 NumFrames;
+	uint32 NumWaits;
+	uint32 NumMissedSamples;
+	double TotalWaitMs;
+	double TotalRecoveredMs;
+
+	bool bPresentHookRegistered;
+};
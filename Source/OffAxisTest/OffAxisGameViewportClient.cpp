@@ -2,6 +2,12 @@
 
 #include "OffAxisTest.h"
 #include "OffAxisGameViewportClient.h"
+#include "OffAxisViewMath.h"
+#include "OffAxisLatencyTracker.h"
+#include "OffAxisFramePacer.h"
+#include "OffAxisSequenceRenderer.h"
+#include "OffAxisPoseServer.h"
+#include "OffAxisRenderOnDemand.h"
 
 #include "Engine/Console.h"
 #include "GameFramework/HUD.h"
@@ -32,6 +38,7 @@
 #include "GameFramework/GameUserSettings.h"
 #include "Runtime/Engine/Classes/Engine/UserInterfaceSettings.h"
 #include "ContentStreaming.h"
+#include "Async/ParallelFor.h"
 
 #include "SGameLayerManager.h"
 #include "ActorEditorUtils.h"
@@ -80,6 +87,57 @@ static TAutoConsoleVariable<int32> CVarScreenshotDelegate(
 	TEXT(" 1: delegates are on (default)"),
 	ECVF_Default);
 
+static TAutoConsoleVariable<int32> CVarOffAxisParallelViewSetup(
+	TEXT("r.OffAxis.ParallelViewSetup"),
+	1,
+	TEXT("Whether the off-axis matrices, frustum bounds and show flag overrides of the views are set up in parallel.\n")
+	TEXT(" 0: off, views are set up one after another\n")
+	TEXT(" 1: on, once r.OffAxis.ParallelViewSetupMinViews views are drawn (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarOffAxisParallelViewSetupMinViews(
+	TEXT("r.OffAxis.ParallelViewSetupMinViews"),
+	4,
+	TEXT("Number of views from which on the per-view setup is spread across worker threads."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarOffAxisScreenNearPlane(
+	TEXT("r.OffAxis.ScreenNearPlane"),
+	0,
+	TEXT("Whether the near clipping plane of the off-axis frustum is placed on the physical screen (window-style rendering).\n")
+	TEXT("Everything on the viewer's side of the screen is then clipped and rejected by frustum culling.\n")
+	TEXT("Requires the eye position to be set with SetOffAxisEyePosition.\n")
+	TEXT(" 0: off (default)\n")
+	TEXT(" 1: on"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisPredictiveStreamingLookahead(
+	TEXT("r.OffAxis.PredictiveStreaming.LookaheadSeconds"),
+	0.0f,
+	TEXT("How far ahead in seconds the eye position is extrapolated to register an additional streaming view.\n")
+	TEXT("0: off (default)"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisPredictiveStreamingMinDistance(
+	TEXT("r.OffAxis.PredictiveStreaming.MinDistance"),
+	1.0f,
+	TEXT("Extrapolated eye offsets shorter than this (in eye position units) do not register a streaming view."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisPredictiveStreamingMaxDistance(
+	TEXT("r.OffAxis.PredictiveStreaming.MaxDistance"),
+	50.0f,
+	TEXT("Longest extrapolated eye offset (in eye position units)."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisPredictiveStreamingBoost(
+	TEXT("r.OffAxis.PredictiveStreaming.Boost"),
+	1.0f,
+	TEXT("Texture streaming boost factor of the extrapolated view."),
+	ECVF_Default);
+
+DECLARE_CYCLE_STAT(TEXT("Off-axis view setup"), STAT_OffAxisViewSetup, STATGROUP_OffAxis);
+
 
 
 /**
@@ -288,15 +346,82 @@ FMatrix UOffAxisGameViewportClient::GenerateOffAxisMatrix(float _screenWidth, fl
 	return GenerateOffAxisMatrix_Internal(_screenWidth, _screenHeight, _eyeRelativePositon, _newNear);
 }
 
+/**
+ * Latest eye sample handed in from any thread. Only the viewport client's Draw takes it over, so trackers never touch
+ * the viewport client or GEngine from their own thread.
+ */
+struct FOffAxisEyeSampleMailbox
+{
+	FCriticalSection	Lock;
+	FOffAxisEyeSample	Sample;
+	bool				bPending = false;
+
+	static FOffAxisEyeSampleMailbox& Get()
+	{
+		static FOffAxisEyeSampleMailbox Mailbox;
+		return Mailbox;
+	}
+};
+
 void UOffAxisGameViewportClient::SetOffAxisMatrix(FMatrix OffAxisMatrix)
 {
+	// The shared pose drives the views while the pose server is read, a local matrix would alternate with it every frame.
+	if (FOffAxisPoseServer::Get().IsReading())
+	{
+		return;
+	}
+
 	auto This = Cast<UOffAxisGameViewportClient>(GEngine->GameViewport);
 
 	if (This)
 	{
 		This->mOffAxisMatrixSetted = true;
 		This->mOffAxisMatrix = OffAxisMatrix;
+		This->mOffAxisSampleCycles = FPlatformTime::Cycles64();
+		This->mEyeSampleSetted = false;
+
+		FOffAxisEyeSampleMailbox& Mailbox = FOffAxisEyeSampleMailbox::Get();
+		FScopeLock Lock(&Mailbox.Lock);
+		Mailbox.bPending = false;
+	}
+}
+
+void UOffAxisGameViewportClient::SetOffAxisEyePosition(float _screenWidth, float _screenHeight, const FVector& _eyeRelativePositon, float _newNear, float _sampleAgeSeconds)
+{
+	FOffAxisEyeSample Sample;
+	Sample.ScreenWidth = _screenWidth;
+	Sample.ScreenHeight = _screenHeight;
+	Sample.EyeRelativePosition = _eyeRelativePositon;
+	Sample.NewNear = _newNear;
+	Sample.SampleCycles = FPlatformTime::Cycles64() - (uint64)(FMath::Max(_sampleAgeSeconds, 0.0f) / FPlatformTime::GetSecondsPerCycle64());
+
+	SetOffAxisEyeSample(Sample);
+}
+
+void UOffAxisGameViewportClient::SetOffAxisEyeSample(const FOffAxisEyeSample& Sample)
+{
+	FOffAxisEyeSample TimedSample = Sample;
+	if (!TimedSample.SampleCycles)
+	{
+		TimedSample.SampleCycles = FPlatformTime::Cycles64();
 	}
+
+	// Share the tracker with the other local instances, unless a replay stands in for it.
+	FOffAxisPoseServer& PoseServer = FOffAxisPoseServer::Get();
+	if (PoseServer.IsPublishing() && !PoseServer.IsReplaying())
+	{
+		PoseServer.Publish(TimedSample);
+	}
+
+	// While the views follow the pose server, local samples would mix with the shared pose between its updates.
+	if (!PoseServer.IsReading())
+	{
+		FOffAxisEyeSampleMailbox& Mailbox = FOffAxisEyeSampleMailbox::Get();
+		FScopeLock Lock(&Mailbox.Lock);
+		Mailbox.Sample = TimedSample;
+		Mailbox.bPending = true;
+	}
+	FOffAxisFramePacer::Get().OnTrackerSample(TimedSample.SampleCycles);
 }
 
 void UOffAxisGameViewportClient::ToggleOffAxisMethod()
@@ -317,84 +442,345 @@ void UOffAxisGameViewportClient::PrintCurrentOffAxisVersioN()
 	UE_LOG(LogConsoleResponse, Warning, TEXT("OffAxisVersion: %s"), (OffAxisVersion ? TEXT("Basic") : TEXT("Optimized"))); //if true (==1) -> basic, else opitmized
 }
 
-static FMatrix _AdjustProjectionMatrixForRHI(const FMatrix& InProjectionMatrix)
+/** Projection matrix (unadjusted for the RHI) that applies OffAxisMatrix to the camera view calculated by CalcSceneView. */
+static FMatrix GetOffAxisProjection(const FMatrix& CameraViewMatrix, const FMatrix& OffAxisMatrix)
 {
-	const float GMinClipZ = 0.0f;
-	const float GProjectionSignY = 1.0f;
+	if (OffAxisVersion == 0)
+	{
+		return OffAxisMatrix;
+	}
 
-	FScaleMatrix ClipSpaceFixScale(FVector(1.0f, GProjectionSignY, 1.0f - GMinClipZ));
-	FTranslationMatrix ClipSpaceFixTranslate(FVector(0.0f, 0.0f, GMinClipZ));
-	return InProjectionMatrix * ClipSpaceFixScale * ClipSpaceFixTranslate;
+	FMatrix axisChanger;
+
+	axisChanger.SetIdentity();
+	axisChanger.M[0][0] = 0.0f;
+	axisChanger.M[1][1] = 0.0f;
+	axisChanger.M[2][2] = 0.0f;
+
+	axisChanger.M[0][2] = 1.0f;
+	axisChanger.M[1][0] = 1.0f;
+	axisChanger.M[2][1] = 1.0f;
+
+	return CameraViewMatrix.Inverse() * axisChanger * OffAxisMatrix;
 }
 
-static void UpdateProjectionMatrix(FSceneView* View, FMatrix OffAxisMatrix)
+/**
+ * World space apex of a perspective view projection, i.e. the point whose clip space x, y and w are all zero.
+ * For off-axis projections this is the tracked eye rather than the camera location.
+ */
+static bool GetFrustumApex(const FMatrix& ViewProjectionMatrix, FVector& OutApex)
 {
+	const FMatrix& M = ViewProjectionMatrix;
+	const int32 Columns[] = { 0, 1, 3 };
 
+	// Solve Apex * M[0..2][j] = -M[3][j] for the clip space x, y and w columns with Cramer's rule.
+	float A[3][3];
+	float B[3];
+	for (int32 Row = 0; Row < 3; ++Row)
+	{
+		const int32 Column = Columns[Row];
+		A[Row][0] = M.M[0][Column];
+		A[Row][1] = M.M[1][Column];
+		A[Row][2] = M.M[2][Column];
+		B[Row] = -M.M[3][Column];
+	}
+
+	auto Determinant = [](const float D[3][3])
+	{
+		return D[0][0] * (D[1][1] * D[2][2] - D[1][2] * D[2][1])
+			- D[0][1] * (D[1][0] * D[2][2] - D[1][2] * D[2][0])
+			+ D[0][2] * (D[1][0] * D[2][1] - D[1][1] * D[2][0]);
+	};
+
+	const float Det = Determinant(A);
+	if (FMath::Abs(Det) < SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		float Ai[3][3];
+		FMemory::Memcpy(Ai, A, sizeof(A));
+		for (int32 Row = 0; Row < 3; ++Row)
+		{
+			Ai[Row][Axis] = B[Row];
+		}
+		OutApex[Axis] = Determinant(Ai) / Det;
+	}
+	return true;
+}
+
+/** Distance from the eye to the physical screen plane, in the units of the eye position. */
+static float GetEyeToScreenDistance(const FOffAxisEyeSample& EyeSample)
+{
 	if (OffAxisVersion == 0)
 	{
-		View->ProjectionMatrixUnadjustedForRHI = OffAxisMatrix;
+		return FMath::Abs(EyeSample.EyeRelativePosition.Z);
+	}
+	return FMath::Abs(EyeSample.EyeRelativePosition.Z - EyeSample.NewNear);
+}
 
-		FMatrix* pInvViewMatrix = (FMatrix*)(&View->ViewMatrices.GetInvViewMatrix());
-		*pInvViewMatrix = View->ViewMatrices.GetViewMatrix().Inverse();
+/**
+ * Moves the near plane of a reversed-Z infinite projection onto the plane EyeToScreenDistance in front of the apex.
+ * The screen is parallel to the near plane of the off-axis frustum, so this clips exactly at the glass.
+ */
+static void ApplyScreenNearPlane(FMatrix& ProjectionMatrix, float EyeToScreenDistance)
+{
+	// Clip space w grows by the length of its view space gradient per unit of distance from the apex.
+	const float WScale = FVector(ProjectionMatrix.M[0][3], ProjectionMatrix.M[1][3], ProjectionMatrix.M[2][3]).Size();
 
-		FVector* pPreViewTranslation = (FVector*)(&View->ViewMatrices.GetPreViewTranslation());
-		*pPreViewTranslation = -View->ViewMatrices.GetViewOrigin();
+	ProjectionMatrix.M[0][2] = 0.0f;
+	ProjectionMatrix.M[1][2] = 0.0f;
+	ProjectionMatrix.M[2][2] = 0.0f;
+	ProjectionMatrix.M[3][2] = WScale * EyeToScreenDistance;
+}
 
-		FMatrix* pProjectionMatrix = (FMatrix*)(&View->ViewMatrices.GetProjectionMatrix());
-		*pProjectionMatrix = _AdjustProjectionMatrixForRHI(View->ProjectionMatrixUnadjustedForRHI);
+/** Rejects everything on the viewer's side of the screen plane in frustum culling. */
+static void AddScreenCullingPlane(FSceneView* View, float EyeToScreenDistance)
+{
+	const FMatrix ViewProjectionMatrix = View->ViewMatrices.GetViewMatrix() * View->ViewMatrices.GetProjectionMatrix();
+	const FVector WGradient(ViewProjectionMatrix.M[0][3], ViewProjectionMatrix.M[1][3], ViewProjectionMatrix.M[2][3]);
+	const float WScale = WGradient.Size();
+	if (WScale < SMALL_NUMBER)
+	{
+		return;
+	}
 
-		FMatrix TranslatedViewMatrix = FTranslationMatrix(-View->ViewMatrices.GetPreViewTranslation()) * View->ViewMatrices.GetViewMatrix();
-		FMatrix* pTranslatedViewProjectionMatrix = (FMatrix*)(&View->ViewMatrices.GetTranslatedViewProjectionMatrix());
-		*pTranslatedViewProjectionMatrix = TranslatedViewMatrix * View->ViewMatrices.GetProjectionMatrix();
+	// Points behind the glass satisfy Normal | P >= W, Normal pointing away from the viewer.
+	const FVector Normal = WGradient / WScale;
+	const float W = EyeToScreenDistance - ViewProjectionMatrix.M[3][3] / WScale;
+
+	View->ViewFrustum.Planes.Add(FPlane(-Normal, -W));
+	View->ViewFrustum.Init();
+
+	View->bHasNearClippingPlane = true;
+	View->NearClippingPlane = FPlane(Normal, W);
+}
 
-		FMatrix* pInvTranslatedViewProjectionMatrixx = (FMatrix*)(&View->ViewMatrices.GetInvTranslatedViewProjectionMatrix());
-		*pInvTranslatedViewProjectionMatrixx = View->ViewMatrices.GetTranslatedViewProjectionMatrix().Inverse();
+/**
+ * View and projection that render the same image as CameraViewMatrix * OffAxisProjection, with the view re-centred
+ * on the eye, the apex of the frustum, and rotated to look along the frustum axis. The projection then keeps the
+ * engine's w = view space z form, so the temporal AA jitter the renderer adds to it moves every pixel by the same
+ * amount and FViewMatrices derives the inverse, translated and previous frame matrices consistently.
+ */
+static bool GetEyeViewInitOptions(const FMatrix& CameraViewMatrix, const FMatrix& OffAxisProjection, const FIntRect& ViewRect, FSceneViewInitOptions& OutInitOptions)
+{
+	const FMatrix ViewProjectionMatrix = CameraViewMatrix * OffAxisProjection;
 
-		View->ShadowViewMatrices = View->ViewMatrices;
+	// Clip space w grows along the frustum axis, away from the eye.
+	const FVector WGradient(ViewProjectionMatrix.M[0][3], ViewProjectionMatrix.M[1][3], ViewProjectionMatrix.M[2][3]);
+	const float WScale = WGradient.Size();
 
-		GetViewFrustumBounds(View->ViewFrustum, View->ViewMatrices.GetViewProjectionMatrix(), false);
+	FVector EyeLocation;
+	if (WScale < SMALL_NUMBER || !GetFrustumApex(ViewProjectionMatrix, EyeLocation))
+	{
+		return false;
 	}
-	else
+
+	const FVector Forward = WGradient / WScale;
+	const FMatrix CameraRotation = CameraViewMatrix.RemoveTranslation();
+	const FVector CameraUp(CameraRotation.M[0][1], CameraRotation.M[1][1], CameraRotation.M[2][1]);
+	const FVector Up = (CameraUp - (CameraUp | Forward) * Forward).GetSafeNormal();
+	const FVector Right = Up ^ Forward;
+
+	// World to view space (x right, y up, z forward) of the eye.
+	const FMatrix EyeRotation(
+		FPlane(Right.X, Up.X, Forward.X, 0.0f),
+		FPlane(Right.Y, Up.Y, Forward.Y, 0.0f),
+		FPlane(Right.Z, Up.Z, Forward.Z, 0.0f),
+		FPlane(0.0f, 0.0f, 0.0f, 1.0f));
+
+	FMatrix EyeProjection = (FTranslationMatrix(-EyeLocation) * EyeRotation).Inverse() * ViewProjectionMatrix;
+	EyeProjection *= 1.0f / WScale;
+
+	// The apex is the origin now, remove the round off so the projection is recognised as perspective with w = z.
+	EyeProjection.M[0][3] = 0.0f;
+	EyeProjection.M[1][3] = 0.0f;
+	EyeProjection.M[2][3] = 1.0f;
+	EyeProjection.M[3][3] = 0.0f;
+
+	OutInitOptions.ViewOrigin = EyeLocation;
+	OutInitOptions.ViewRotationMatrix = EyeRotation;
+	OutInitOptions.ProjectionMatrix = EyeProjection;
+	OutInitOptions.SetViewRectangle(ViewRect);
+	return true;
+}
+
+int32 FOffAxisViewMath::GetMethod()
+{
+	return OffAxisVersion;
+}
+
+void FOffAxisViewMath::SetMethod(int32 Method)
+{
+	OffAxisVersion = Method;
+}
+
+FMatrix FOffAxisViewMath::GetOffAxisProjection(const FMatrix& CameraViewMatrix, const FMatrix& OffAxisMatrix)
+{
+	return ::GetOffAxisProjection(CameraViewMatrix, OffAxisMatrix);
+}
+
+bool FOffAxisViewMath::GetEyeViewInitOptions(const FMatrix& CameraViewMatrix, const FMatrix& OffAxisProjection, const FIntRect& ViewRect, FSceneViewInitOptions& OutInitOptions)
+{
+	return ::GetEyeViewInitOptions(CameraViewMatrix, OffAxisProjection, ViewRect, OutInitOptions);
+}
+
+/** Replaces the view and projection of a view calculated by CalcSceneView with the off-axis frustum. */
+static void UpdateProjectionMatrix(FSceneView* View, FMatrix OffAxisMatrix, float EyeToScreenDistance)
+{
+	FMatrix OffAxisProjection = GetOffAxisProjection(View->ViewMatrices.GetViewMatrix(), OffAxisMatrix);
+	if (EyeToScreenDistance > 0.0f)
 	{
-		FMatrix axisChanger;
+		ApplyScreenNearPlane(OffAxisProjection, EyeToScreenDistance);
+	}
 
-		axisChanger.SetIdentity();
-		axisChanger.M[0][0] = 0.0f;
-		axisChanger.M[1][1] = 0.0f;
-		axisChanger.M[2][2] = 0.0f;
+	FSceneViewInitOptions InitOptions;
+	if (!GetEyeViewInitOptions(View->ViewMatrices.GetViewMatrix(), OffAxisProjection, View->UnscaledViewRect, InitOptions))
+	{
+		// Not a perspective frustum, apply it to the camera view as it is rather than drop it.
+		ensureMsgf(false, TEXT("OffAxis: the off-axis frustum has no apex, the view is not re-centred on the eye"));
+		InitOptions.ViewOrigin = View->ViewMatrices.GetViewOrigin();
+		InitOptions.ViewRotationMatrix = View->ViewMatrices.GetViewMatrix().RemoveTranslation();
+		InitOptions.ProjectionMatrix = OffAxisProjection;
+		InitOptions.SetViewRectangle(View->UnscaledViewRect);
+	}
 
-		axisChanger.M[0][2] = 1.0f;
-		axisChanger.M[1][0] = 1.0f;
-		axisChanger.M[2][1] = 1.0f;
+	View->ProjectionMatrixUnadjustedForRHI = InitOptions.ProjectionMatrix;
+	View->ViewMatrices = FViewMatrices(InitOptions);
+	View->ShadowViewMatrices = View->ViewMatrices;
+	View->InvDeviceZToWorldZTransform = CreateInvDeviceZToWorldZTransform(InitOptions.ProjectionMatrix);
 
-		View->ProjectionMatrixUnadjustedForRHI = View->ViewMatrices.GetViewMatrix().Inverse() * axisChanger * OffAxisMatrix;
+	GetViewFrustumBounds(View->ViewFrustum, View->ViewMatrices.GetViewProjectionMatrix(), false);
 
-		FMatrix* pInvViewMatrix = (FMatrix*)(&View->ViewMatrices.GetInvViewMatrix());
-		*pInvViewMatrix = View->ViewMatrices.GetViewMatrix().Inverse();
+	// As FSceneView derives them: with reversed Z the near plane is where device z reaches 1, at view space
+	// z = M[3][2] / (1 - M[2][2]) for the w = z projection of the eye.
+	const FMatrix& EyeProjection = View->ViewMatrices.GetProjectionMatrix();
+	if (EyeProjection.M[2][2] < 1.0f - KINDA_SMALL_NUMBER)
+	{
+		View->NearClippingDistance = EyeProjection.M[3][2] / (1.0f - EyeProjection.M[2][2]);
+	}
+	View->bHasNearClippingPlane = View->ViewMatrices.GetViewProjectionMatrix().GetFrustumFarPlane(View->NearClippingPlane);
 
-		FMatrix* pProjectionMatrix = (FMatrix*)(&View->ViewMatrices.GetProjectionMatrix());
-		*pProjectionMatrix = _AdjustProjectionMatrixForRHI(View->ProjectionMatrixUnadjustedForRHI);
+	if (EyeToScreenDistance > 0.0f)
+	{
+		AddScreenCullingPlane(View, EyeToScreenDistance);
+	}
+}
 
+/**
+ * Registers the view the eye is extrapolated to reach r.OffAxis.PredictiveStreaming.LookaheadSeconds from now
+ * with texture and level streaming, so content it reveals is requested before it comes into view.
+ */
+static void AddPredictiveStreamingHint(UWorld* World, const FSceneView* View, const FMatrix& CameraViewMatrix, const FOffAxisEyeSample& EyeSample, const FVector& EyeVelocity)
+{
+	const float LookaheadSeconds = CVarOffAxisPredictiveStreamingLookahead.GetValueOnGameThread();
+	if (LookaheadSeconds <= 0.0f)
+	{
+		return;
+	}
 
-		FMatrix TranslatedViewMatrix = FTranslationMatrix(-View->ViewMatrices.GetPreViewTranslation()) * View->ViewMatrices.GetViewMatrix();
+	const FVector Offset = (EyeVelocity * LookaheadSeconds).GetClampedToMaxSize(CVarOffAxisPredictiveStreamingMaxDistance.GetValueOnGameThread());
+	if (Offset.Size() < CVarOffAxisPredictiveStreamingMinDistance.GetValueOnGameThread())
+	{
+		return;
+	}
 
-		FMatrix* pTranslatedViewMatrix = (FMatrix*)(&View->ViewMatrices.GetTranslatedViewMatrix());
-		*pTranslatedViewMatrix = TranslatedViewMatrix;
-	
-		FMatrix* pInvTranslatedViewMatrix = (FMatrix*)(&View->ViewMatrices.GetInvTranslatedViewMatrix());
-		*pInvTranslatedViewMatrix = TranslatedViewMatrix.Inverse();
-			
-		FMatrix* pTranslatedViewProjectionMatrix = (FMatrix*)(&View->ViewMatrices.GetTranslatedViewProjectionMatrix());
-		*pTranslatedViewProjectionMatrix = TranslatedViewMatrix * View->ViewMatrices.GetProjectionMatrix();	
-		
-		FMatrix* pInvTranslatedViewProjectionMatrix = (FMatrix*)(&View->ViewMatrices.GetInvTranslatedViewProjectionMatrix());
-		*pInvTranslatedViewProjectionMatrix = View->ViewMatrices.GetTranslatedViewProjectionMatrix().Inverse();
+	// Prefetching only makes sense while the streaming pool still has room for it.
+	IStreamingManager& StreamingManager = IStreamingManager::Get();
+	if (StreamingManager.GetTextureStreamingManager().GetMemoryOverBudget() > 0)
+	{
+		return;
+	}
+
+	// Predict the view the way UpdateProjectionMatrix builds it, so the hint asks for the screen size the view will have.
+	const FMatrix PredictedOffAxisMatrix = GenerateOffAxisMatrix_Internal(EyeSample.ScreenWidth, EyeSample.ScreenHeight, EyeSample.EyeRelativePosition + Offset, EyeSample.NewNear);
+	FSceneViewInitOptions PredictedView;
+	if (!GetEyeViewInitOptions(CameraViewMatrix, GetOffAxisProjection(CameraViewMatrix, PredictedOffAxisMatrix), View->UnscaledViewRect, PredictedView))
+	{
+		return;
+	}
+
+	StreamingManager.AddViewInformation(PredictedView.ViewOrigin, View->ViewRect.Width(), View->ViewRect.Width() * PredictedView.ProjectionMatrix.M[0][0], CVarOffAxisPredictiveStreamingBoost.GetValueOnGameThread());
+	World->ViewLocationsRenderedLastFrame.Add(PredictedView.ViewOrigin);
+}
+
+/** A view calculated for a local player, waiting for its off-axis setup. */
+struct FOffAxisPendingView
+{
+	ULocalPlayer*		LocalPlayer = nullptr;
+	FSceneView*			View = nullptr;
+	FVector				ViewLocation = FVector::ZeroVector;
+	FRotator			ViewRotation = FRotator::ZeroRotator;
+	EStereoscopicPass	PassType = eSSP_FULL;
+	int32				ViewIndex = 0;
+
+	/** View matrix of the camera as calculated by CalcSceneView, before the view is re-centred on the eye. */
+	FMatrix				CameraViewMatrix = FMatrix::Identity;
+};
+
+/** Material overrides the engine show flags request for a view. */
+static void ApplyShowFlagOverrides(FSceneView* View)
+{
+	if (View->Family->EngineShowFlags.Wireframe)
+	{
+		// Wireframe color is emissive-only, and mesh-modifying materials do not use material substitution, hence...
+		View->DiffuseOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
+		View->SpecularOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
+	}
+	else if (View->Family->EngineShowFlags.OverrideDiffuseAndSpecular)
+	{
+		View->DiffuseOverrideParameter = FVector4(GEngine->LightingOnlyBrightness.R, GEngine->LightingOnlyBrightness.G, GEngine->LightingOnlyBrightness.B, 0.0f);
+		View->SpecularOverrideParameter = FVector4(.1f, .1f, .1f, 0.0f);
+	}
+	else if (View->Family->EngineShowFlags.ReflectionOverride)
+	{
+		View->DiffuseOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
+		View->SpecularOverrideParameter = FVector4(1, 1, 1, 0.0f);
+		View->NormalOverrideParameter = FVector4(0, 0, 1, 0.0f);
+		View->RoughnessOverrideParameter = FVector2D(0.0f, 0.0f);
+	}
+
+	if (!View->Family->EngineShowFlags.Diffuse)
+	{
+		View->DiffuseOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
+	}
+
+	if (!View->Family->EngineShowFlags.Specular)
+	{
+		View->SpecularOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
+	}
+}
 
+/** Samples further apart than this belong to a new tracking session. */
+static const double EyeSessionGapSeconds = 0.25;
+
+void UOffAxisGameViewportClient::UpdateEyeVelocity(const FOffAxisEyeSample& EyeSample)
+{
+	if (EyeSample.SampleCycles == mLastEyeSample.SampleCycles)
+	{
+		// Without new samples the viewer left or tracking was lost, stop extrapolating.
+		if (FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - EyeSample.SampleCycles) > EyeSessionGapSeconds)
+		{
+			mEyeVelocity = FVector::ZeroVector;
+		}
+		return;
+	}
 
-		View->ShadowViewMatrices = View->ViewMatrices;
+	const double DeltaSeconds = FPlatformTime::ToSeconds64(EyeSample.SampleCycles - mLastEyeSample.SampleCycles);
 
-		GetViewFrustumBounds(View->ViewFrustum, View->ViewMatrices.GetViewProjectionMatrix(), false);
+	if (mLastEyeSample.SampleCycles != 0 && DeltaSeconds > 0.0 && DeltaSeconds < EyeSessionGapSeconds)
+	{
+		const FVector SampleVelocity = (EyeSample.EyeRelativePosition - mLastEyeSample.EyeRelativePosition) / DeltaSeconds;
+		mEyeVelocity = FMath::Lerp(mEyeVelocity, SampleVelocity, 0.5f);
+	}
+	else
+	{
+		mEyeVelocity = FVector::ZeroVector;
 	}
+
+	mLastEyeSample = EyeSample;
 }
 
 void UOffAxisGameViewportClient::Draw(FViewport* InViewport, FCanvas* SceneCanvas)
@@ -496,135 +882,207 @@ void UOffAxisGameViewportClient::Draw(FViewport* InViewport, FCanvas* SceneCanva
 		}
 	}
 
+	// Generate the off-axis matrix from the latest eye sample as late as possible.
+	FOffAxisSequenceRenderer& SequenceRenderer = FOffAxisSequenceRenderer::Get();
+	SequenceRenderer.Tick();
+
+	// Offline sequences take the eye from the recorded trajectory and the screen from the scene.
+	FVector SequenceEyePosition;
+	const bool bSequenceFrame = SequenceRenderer.GetFrameEyePosition(SequenceEyePosition);
+
+	if (!bSequenceFrame)
+	{
+		FOffAxisFramePacer::Get().WaitForFreshSample();
+	}
+
+	// A pose published by another instance (or this one) replaces the local tracker. Between two published poses the
+	// last one is kept, local samples are not mixed in.
+	FOffAxisPoseServer& PoseServer = FOffAxisPoseServer::Get();
+	FOffAxisEyeSample EyeSample;
+	if (PoseServer.IsReading())
+	{
+		if (PoseServer.ReadPose(EyeSample))
+		{
+			mEyeSample = EyeSample;
+			mEyeSampleSetted = true;
+		}
+	}
+	else
+	{
+		// Take over the latest sample handed in from the tracker.
+		FOffAxisEyeSampleMailbox& Mailbox = FOffAxisEyeSampleMailbox::Get();
+		FScopeLock Lock(&Mailbox.Lock);
+		if (Mailbox.bPending)
+		{
+			mEyeSample = Mailbox.Sample;
+			mEyeSampleSetted = true;
+			Mailbox.bPending = false;
+		}
+	}
+
+	const bool bHasEyeSample = mEyeSampleSetted;
+	if (bHasEyeSample)
+	{
+		EyeSample = mEyeSample;
+
+		if (bSequenceFrame)
+		{
+			EyeSample.EyeRelativePosition = SequenceEyePosition;
+			EyeSample.SampleCycles = FPlatformTime::Cycles64();
+		}
+
+		mOffAxisMatrix = GenerateOffAxisMatrix_Internal(EyeSample.ScreenWidth, EyeSample.ScreenHeight, EyeSample.EyeRelativePosition, EyeSample.NewNear);
+		mOffAxisMatrixSetted = true;
+		mOffAxisSampleCycles = EyeSample.SampleCycles;
+
+		UpdateEyeVelocity(EyeSample);
+	}
+
+	if (mOffAxisMatrixSetted)
+	{
+		FOffAxisLatencyTracker::Get().TrackFrame(mOffAxisSampleCycles, GFrameNumber);
+	}
+
 	TMap<ULocalPlayer*, FSceneView*> PlayerViewMap;
 
 	FAudioDevice* AudioDevice = MyWorld->GetAudioDevice();
 
+	// Calculate the player's view information. CalcSceneView touches the player camera and stays serial.
+	TArray<FOffAxisPendingView, TInlineAllocator<16>> PendingViews;
 	for (FLocalPlayerIterator Iterator(GEngine, MyWorld); Iterator; ++Iterator)
 	{
 		ULocalPlayer* LocalPlayer = *Iterator;
 		if (LocalPlayer)
 		{
-			APlayerController* PlayerController = LocalPlayer->PlayerController;
-
 			int32 NumViews = bStereoRendering ? 2 : 1;
 
 			for (int32 i = 0; i < NumViews; ++i)
 			{
-				// Calculate the player's view information.
-				FVector		ViewLocation;
-				FRotator	ViewRotation;
+				FOffAxisPendingView& PendingView = PendingViews[PendingViews.AddDefaulted()];
+				PendingView.LocalPlayer = LocalPlayer;
+				PendingView.ViewIndex = i;
+				PendingView.PassType = !bStereoRendering ? eSSP_FULL : ((i == 0) ? eSSP_LEFT_EYE : eSSP_RIGHT_EYE);
+				PendingView.View = LocalPlayer->CalcSceneView(&ViewFamily, PendingView.ViewLocation, PendingView.ViewRotation, InViewport, &GameViewDrawer, PendingView.PassType);
+				if (PendingView.View)
+				{
+					PendingView.CameraViewMatrix = PendingView.View->ViewMatrices.GetViewMatrix();
+				}
+			}
+		}
+	}
+
+	// Off-axis matrices, derived matrices, frustum bounds and show flag overrides only touch their own view.
+	{
+		SCOPE_CYCLE_COUNTER(STAT_OffAxisViewSetup);
+
+		const bool bParallelViewSetup = CVarOffAxisParallelViewSetup.GetValueOnGameThread() != 0
+			&& PendingViews.Num() >= CVarOffAxisParallelViewSetupMinViews.GetValueOnGameThread();
 
-				EStereoscopicPass PassType = !bStereoRendering ? eSSP_FULL : ((i == 0) ? eSSP_LEFT_EYE : eSSP_RIGHT_EYE);
+		const bool bUpdateOffAxis = mOffAxisMatrixSetted;
+		const FMatrix OffAxisMatrix = mOffAxisMatrix;
+		const FName BufferVisualizationMode = CurrentBufferVisualizationMode;
 
-				FSceneView* View = LocalPlayer->CalcSceneView(&ViewFamily, ViewLocation, ViewRotation, InViewport, &GameViewDrawer, PassType);
+		// The screen plane is only known when the matrix is generated from an eye sample.
+		const float EyeToScreenDistance = bHasEyeSample && CVarOffAxisScreenNearPlane.GetValueOnGameThread() != 0 ? GetEyeToScreenDistance(EyeSample) : 0.0f;
 
+		ParallelFor(PendingViews.Num(), [&PendingViews, bUpdateOffAxis, &OffAxisMatrix, EyeToScreenDistance, BufferVisualizationMode](int32 Index)
+		{
+			FSceneView* View = PendingViews[Index].View;
+			if (View)
+			{
 				/************************************************************************/
 				/* OFF-AXIS-MAGIC                                                       */
 				/************************************************************************/
-				if (mOffAxisMatrixSetted)
-					UpdateProjectionMatrix(View, mOffAxisMatrix);
+				if (bUpdateOffAxis)
+					UpdateProjectionMatrix(View, OffAxisMatrix, EyeToScreenDistance);
 				/************************************************************************/
 				/* OFF-AXIS-MAGIC                                                       */
 				/************************************************************************/
 
-				if (View)
-				{
-					if (View->Family->EngineShowFlags.Wireframe)
-					{
-						// Wireframe color is emissive-only, and mesh-modifying materials do not use material substitution, hence...
-						View->DiffuseOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
-						View->SpecularOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
-					}
-					else if (View->Family->EngineShowFlags.OverrideDiffuseAndSpecular)
-					{
-						View->DiffuseOverrideParameter = FVector4(GEngine->LightingOnlyBrightness.R, GEngine->LightingOnlyBrightness.G, GEngine->LightingOnlyBrightness.B, 0.0f);
-						View->SpecularOverrideParameter = FVector4(.1f, .1f, .1f, 0.0f);
-					}
-					else if (View->Family->EngineShowFlags.ReflectionOverride)
-					{
-						View->DiffuseOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
-						View->SpecularOverrideParameter = FVector4(1, 1, 1, 0.0f);
-						View->NormalOverrideParameter = FVector4(0, 0, 1, 0.0f);
-						View->RoughnessOverrideParameter = FVector2D(0.0f, 0.0f);
-					}
-
-					if (!View->Family->EngineShowFlags.Diffuse)
-					{
-						View->DiffuseOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
-					}
-
-					if (!View->Family->EngineShowFlags.Specular)
-					{
-						View->SpecularOverrideParameter = FVector4(0.f, 0.f, 0.f, 0.f);
-					}
-
-					View->CurrentBufferVisualizationMode = CurrentBufferVisualizationMode;
+				ApplyShowFlagOverrides(View);
 
-					View->CameraConstrainedViewRect = View->UnscaledViewRect;
+				View->CurrentBufferVisualizationMode = BufferVisualizationMode;
 
-					// If this is the primary drawing pass, update things that depend on the view location
-					if (i == 0)
-					{
-						// Save the location of the view.
-						LocalPlayer->LastViewLocation = ViewLocation;
+				View->CameraConstrainedViewRect = View->UnscaledViewRect;
+			}
+		}, !bParallelViewSetup);
+	}
 
-						PlayerViewMap.Add(LocalPlayer, View);
+	// Listener updates, the player view map and streaming registration depend on the view order.
+	for (const FOffAxisPendingView& PendingView : PendingViews)
+	{
+		FSceneView* View = PendingView.View;
+		if (View)
+		{
+			ULocalPlayer* LocalPlayer = PendingView.LocalPlayer;
+			APlayerController* PlayerController = LocalPlayer->PlayerController;
+			const EStereoscopicPass PassType = PendingView.PassType;
 
-						// Update the listener.
-						if (AudioDevice != NULL && PlayerController != NULL)
-						{
-							bool bUpdateListenerPosition = true;
+			// If this is the primary drawing pass, update things that depend on the view location
+			if (PendingView.ViewIndex == 0)
+			{
+				// Save the location of the view.
+				LocalPlayer->LastViewLocation = PendingView.ViewLocation;
 
-							// If the main audio device is used for multiple PIE viewport clients, we only
-							// want to update the main audio device listener position if it is in focus
-							if (GEngine)
-							{
-								FAudioDeviceManager* AudioDeviceManager = GEngine->GetAudioDeviceManager();
+				PlayerViewMap.Add(LocalPlayer, View);
 
-								// If there is more than one world referencing the main audio device
-								if (AudioDeviceManager->GetNumMainAudioDeviceWorlds() > 1)
-								{
-									uint32 MainAudioDeviceHandle = GEngine->GetAudioDeviceHandle();
+				// Update the listener.
+				if (AudioDevice != NULL && PlayerController != NULL)
+				{
+					bool bUpdateListenerPosition = true;
 
-								}
-							}
+					// If the main audio device is used for multiple PIE viewport clients, we only
+					// want to update the main audio device listener position if it is in focus
+					if (GEngine)
+					{
+						FAudioDeviceManager* AudioDeviceManager = GEngine->GetAudioDeviceManager();
 
-							if (bUpdateListenerPosition)
-							{
-								FVector Location;
-								FVector ProjFront;
-								FVector ProjRight;
-								PlayerController->GetAudioListenerPosition(/*out*/ Location, /*out*/ ProjFront, /*out*/ ProjRight);
+						// If there is more than one world referencing the main audio device
+						if (AudioDeviceManager->GetNumMainAudioDeviceWorlds() > 1)
+						{
+							uint32 MainAudioDeviceHandle = GEngine->GetAudioDeviceHandle();
 
-								FTransform ListenerTransform(FRotationMatrix::MakeFromXY(ProjFront, ProjRight));
+						}
+					}
 
-								// Allow the HMD to adjust based on the head position of the player, as opposed to the view location
-								if (GEngine->XRSystem.IsValid() && GEngine->StereoRenderingDevice.IsValid() && GEngine->StereoRenderingDevice->IsStereoEnabled())
-								{
-									const FVector Offset = GEngine->XRSystem->GetAudioListenerOffset();
-									Location += ListenerTransform.TransformPositionNoScale(Offset);
-								}
+					if (bUpdateListenerPosition)
+					{
+						FVector Location;
+						FVector ProjFront;
+						FVector ProjRight;
+						PlayerController->GetAudioListenerPosition(/*out*/ Location, /*out*/ ProjFront, /*out*/ ProjRight);
 
-								ListenerTransform.SetTranslation(Location);
-								ListenerTransform.NormalizeRotation();
+						FTransform ListenerTransform(FRotationMatrix::MakeFromXY(ProjFront, ProjRight));
 
-								uint32 ViewportIndex = PlayerViewMap.Num() - 1;
-								AudioDevice->SetListener(MyWorld, ViewportIndex, ListenerTransform, (View->bCameraCut ? 0.f : MyWorld->GetDeltaSeconds()));
-							}
-						}
-						if (PassType == eSSP_LEFT_EYE)
+						// Allow the HMD to adjust based on the head position of the player, as opposed to the view location
+						if (GEngine->XRSystem.IsValid() && GEngine->StereoRenderingDevice.IsValid() && GEngine->StereoRenderingDevice->IsStereoEnabled())
 						{
-							// Save the size of the left eye view, so we can use it to reinitialize the DebugCanvasObject when rendering the console at the end of this method
-							DebugCanvasSize = View->UnscaledViewRect.Size();
+							const FVector Offset = GEngine->XRSystem->GetAudioListenerOffset();
+							Location += ListenerTransform.TransformPositionNoScale(Offset);
 						}
 
-					}
+						ListenerTransform.SetTranslation(Location);
+						ListenerTransform.NormalizeRotation();
 
-					// Add view information for resource streaming.
-					IStreamingManager::Get().AddViewInformation(View->ViewMatrices.GetViewOrigin(), View->ViewRect.Width(), View->ViewRect.Width() * View->ViewMatrices.GetProjectionMatrix().M[0][0]);
-					MyWorld->ViewLocationsRenderedLastFrame.Add(View->ViewMatrices.GetViewOrigin());
+						uint32 ViewportIndex = PlayerViewMap.Num() - 1;
+						AudioDevice->SetListener(MyWorld, ViewportIndex, ListenerTransform, (View->bCameraCut ? 0.f : MyWorld->GetDeltaSeconds()));
+					}
 				}
+				if (PassType == eSSP_LEFT_EYE)
+				{
+					// Save the size of the left eye view, so we can use it to reinitialize the DebugCanvasObject when rendering the console at the end of this method
+					DebugCanvasSize = View->UnscaledViewRect.Size();
+				}
+
+			}
+
+			// Add view information for resource streaming.
+			IStreamingManager::Get().AddViewInformation(View->ViewMatrices.GetViewOrigin(), View->ViewRect.Width(), View->ViewRect.Width() * View->ViewMatrices.GetProjectionMatrix().M[0][0]);
+			MyWorld->ViewLocationsRenderedLastFrame.Add(View->ViewMatrices.GetViewOrigin());
+
+			if (bHasEyeSample)
+			{
+				AddPredictiveStreamingHint(MyWorld, View, PendingView.CameraViewMatrix, EyeSample, mEyeVelocity);
 			}
 		}
 	}
@@ -677,7 +1135,19 @@ void UOffAxisGameViewportClient::Draw(FViewport* InViewport, FCanvas* SceneCanva
 	// Draw the player views.
 	if (!bDisableWorldRendering && !bUIDisableWorldRendering && PlayerViewMap.Num() > 0) //-V560
 	{
-		GetRendererModule().BeginRenderingViewFamily(SceneCanvas, &ViewFamily);
+		// Re-present the last scene image while neither the views nor the scene changed. Offline sequences render every frame.
+		FOffAxisRenderOnDemand& RenderOnDemand = FOffAxisRenderOnDemand::Get();
+		if (SequenceRenderer.IsRendering() || RenderOnDemand.ShouldRenderScene(MyWorld, InViewport, ViewFamily))
+		{
+			GetRendererModule().BeginRenderingViewFamily(SceneCanvas, &ViewFamily);
+			RenderOnDemand.CaptureFrame(InViewport);
+		}
+		else
+		{
+			// Flush what the canvas queued so far (e.g. the clear of the viewport) so it lands below the restored image.
+			SceneCanvas->Flush_GameThread();
+			RenderOnDemand.RestoreFrame(InViewport);
+		}
 	}
 
 	// Clear areas of the rendertarget (backbuffer) that aren't drawn over by the views.
@@ -831,6 +1301,19 @@ void UOffAxisGameViewportClient::Draw(FViewport* InViewport, FCanvas* SceneCanva
 
 	DrawStatsHUD(MyWorld, InViewport, DebugCanvas, DebugCanvasObject, DebugProperties, PlayerCameraLocation, PlayerCameraRotation);
 
+	if (SequenceRenderer.IsRendering())
+	{
+		if (bHasEyeSample)
+		{
+			SequenceRenderer.CaptureFrame(InViewport);
+		}
+		else
+		{
+			UE_LOG(LogConsoleResponse, Warning, TEXT("OffAxis sequence: no eye position has been set with SetOffAxisEyePosition, the screen size is unknown"));
+			SequenceRenderer.Stop();
+		}
+	}
+
 
 	//EndDrawDelegate.Broadcast();
 }
@@ -5,6 +5,20 @@
 #include "Engine/GameViewportClient.h"
 #include "OffAxisGameViewportClient.generated.h"
 
+/**
+ * Eye position relative to the screen center, together with the screen it was measured against.
+ */
+struct FOffAxisEyeSample
+{
+	float	ScreenWidth = 0.0f;
+	float	ScreenHeight = 0.0f;
+	FVector	EyeRelativePosition = FVector::ZeroVector;
+	float	NewNear = 0.0f;
+
+	/** FPlatformTime::Cycles64() at the time the tracker acquired the sample. */
+	uint64	SampleCycles = 0;
+};
+
 /**
  * 
  */
@@ -21,6 +35,20 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "OffAxis")
 		static void SetOffAxisMatrix(FMatrix OffAxisMatrix);
 
+	/**
+	 * Hands the latest eye position to the viewport, the off-axis matrix is generated from it right before the views are set up.
+	 * _sampleAgeSeconds is how long before this call the tracker acquired the sample, so the latency measurement includes
+	 * the tracker and its transport. Game thread only, tracker threads use SetOffAxisEyeSample.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "OffAxis")
+		static void SetOffAxisEyePosition(float _screenWidth, float _screenHeight, const FVector& _eyeRelativePositon, float _newNear, float _sampleAgeSeconds = 0.0f);
+
+	/**
+	 * Same as SetOffAxisEyePosition for C++ trackers with their own timestamps. A SampleCycles of 0 stands for now.
+	 * Doesn't touch any UObject, so tracker threads can call it for every sample; Draw takes over the latest one.
+	 */
+	static void SetOffAxisEyeSample(const FOffAxisEyeSample& Sample);
+
 	UFUNCTION(BlueprintCallable, Category = "OffAxis")
 		static void ToggleOffAxisMethod();
 
@@ -36,5 +64,18 @@ private:
 	FMatrix		mOffAxisMatrix;
 	bool		mOffAxisMatrixSetted = false;
 
+	/** Latest eye sample, taken over from SetOffAxisEyeSample at the start of Draw. */
+	FOffAxisEyeSample	mEyeSample;
+	bool				mEyeSampleSetted = false;
+
+	/** Smoothed eye velocity in eye position units per second, used to extrapolate streaming views. */
+	FVector				mEyeVelocity = FVector::ZeroVector;
+	FOffAxisEyeSample	mLastEyeSample;
+
+	void UpdateEyeVelocity(const FOffAxisEyeSample& EyeSample);
+
+	/** Timestamp of the sample mOffAxisMatrix was generated from, carried through to present by the latency tracker. */
+	uint64		mOffAxisSampleCycles = 0;
+
 };
 
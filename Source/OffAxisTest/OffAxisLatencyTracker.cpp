@@ -0,0 +1,289 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "OffAxisTest.h"
+#include "OffAxisLatencyTracker.h"
+
+#include "RenderingThread.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Rendering/SlateRenderer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Eye sample age: game thread (ms)"), STAT_OffAxisAgeGameThread, STATGROUP_OffAxis);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Eye sample age: render thread (ms)"), STAT_OffAxisAgeRenderThread, STATGROUP_OffAxis);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Eye sample age: present (ms)"), STAT_OffAxisAgePresent, STATGROUP_OffAxis);
+
+static TAutoConsoleVariable<int32> CVarOffAxisLatencyCsvFrames(
+	TEXT("r.OffAxis.LatencyCsvFrames"),
+	10000,
+	TEXT("Number of most recent frames whose eye sample ages are kept for OffAxis.Latency.DumpCsv.\n")
+	TEXT("0: only the histograms are kept"),
+	ECVF_Default);
+
+static const TCHAR* LatencyStageNames[] = { TEXT("GameThread"), TEXT("RenderThread"), TEXT("Present") };
+
+const float FOffAxisLatencyHistogram::BucketWidthMs = 0.5f;
+
+void FOffAxisLatencyHistogram::Reset()
+{
+	FMemory::Memzero(Buckets);
+	Count = 0;
+	SumMs = 0.0;
+	MaxMs = 0.0f;
+}
+
+void FOffAxisLatencyHistogram::Add(float AgeMs)
+{
+	const int32 Bucket = FMath::Clamp(FMath::FloorToInt(AgeMs / BucketWidthMs), 0, NumBuckets);
+	Buckets[Bucket]++;
+	Count++;
+	SumMs += AgeMs;
+	MaxMs = FMath::Max(MaxMs, AgeMs);
+}
+
+float FOffAxisLatencyHistogram::GetPercentile(float Percentile) const
+{
+	if (Count == 0)
+	{
+		return 0.0f;
+	}
+
+	const uint32 Threshold = FMath::CeilToInt(Count * FMath::Clamp(Percentile, 0.0f, 1.0f));
+	uint32 Accumulated = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		Accumulated += Buckets[Bucket];
+		if (Accumulated >= Threshold)
+		{
+			return (Bucket + 1) * BucketWidthMs;
+		}
+	}
+	return MaxMs;
+}
+
+FOffAxisLatencyTracker& FOffAxisLatencyTracker::Get()
+{
+	static FOffAxisLatencyTracker Tracker;
+	return Tracker;
+}
+
+FOffAxisLatencyTracker::FOffAxisLatencyTracker()
+	: NextFrameRow(0)
+	, PendingPresentCycles(0)
+	, bPresentHookRegistered(false)
+{
+}
+
+float FOffAxisLatencyTracker::CyclesToMs(uint64 SampleCycles)
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+	return Now > SampleCycles ? (float)FPlatformTime::ToMilliseconds64(Now - SampleCycles) : 0.0f;
+}
+
+void FOffAxisLatencyTracker::RegisterPresentHook()
+{
+	if (bPresentHookRegistered || !FSlateApplication::IsInitialized())
+	{
+		return;
+	}
+
+	FSlateRenderer* Renderer = FSlateApplication::Get().GetRenderer();
+	if (Renderer)
+	{
+		Renderer->OnBackBufferReadyToPresent().AddRaw(this, &FOffAxisLatencyTracker::OnBackBufferReadyToPresent);
+		bPresentHookRegistered = true;
+	}
+}
+
+void FOffAxisLatencyTracker::TrackFrame(uint64 SampleCycles, uint32 FrameNumber)
+{
+	check(IsInGameThread());
+
+	if (SampleCycles == 0)
+	{
+		return;
+	}
+
+	RegisterPresentHook();
+
+	const float GameThreadAgeMs = CyclesToMs(SampleCycles);
+	GameThreadHistogram.Add(GameThreadAgeMs);
+	SET_FLOAT_STAT(STAT_OffAxisAgeGameThread, GameThreadAgeMs);
+
+	FOffAxisLatencyTracker* Tracker = this;
+	ENQUEUE_RENDER_COMMAND(OffAxisTrackLatency)(
+		[Tracker, SampleCycles, FrameNumber, GameThreadAgeMs](FRHICommandListImmediate& RHICmdList)
+		{
+			Tracker->RecordRenderThread(SampleCycles, FrameNumber, GameThreadAgeMs);
+		});
+}
+
+void FOffAxisLatencyTracker::RecordRenderThread(uint64 SampleCycles, uint32 FrameNumber, float GameThreadAgeMs)
+{
+	check(IsInRenderingThread());
+
+	const float RenderThreadAgeMs = CyclesToMs(SampleCycles);
+	RenderThreadHistogram.Add(RenderThreadAgeMs);
+	SET_FLOAT_STAT(STAT_OffAxisAgeRenderThread, RenderThreadAgeMs);
+
+	// The previous frame never reached present (no slate renderer, or the window was not drawn), keep it without a present age.
+	if (PendingPresentCycles != 0)
+	{
+		PendingPresentRow.AgeMs[(int32)EOffAxisLatencyStage::Present] = -1.0f;
+		AddFrameRow(PendingPresentRow);
+	}
+
+	PendingPresentRow.FrameNumber = FrameNumber;
+	PendingPresentRow.AgeMs[(int32)EOffAxisLatencyStage::GameThread] = GameThreadAgeMs;
+	PendingPresentRow.AgeMs[(int32)EOffAxisLatencyStage::RenderThread] = RenderThreadAgeMs;
+	PendingPresentRow.AgeMs[(int32)EOffAxisLatencyStage::Present] = 0.0f;
+	PendingPresentCycles = SampleCycles;
+}
+
+void FOffAxisLatencyTracker::OnBackBufferReadyToPresent(SWindow& Window, const FTexture2DRHIRef& BackBuffer)
+{
+	check(IsInRenderingThread());
+
+	if (PendingPresentCycles == 0)
+	{
+		return;
+	}
+
+	const float PresentAgeMs = CyclesToMs(PendingPresentCycles);
+	PresentHistogram.Add(PresentAgeMs);
+	SET_FLOAT_STAT(STAT_OffAxisAgePresent, PresentAgeMs);
+
+	PendingPresentRow.AgeMs[(int32)EOffAxisLatencyStage::Present] = PresentAgeMs;
+	AddFrameRow(PendingPresentRow);
+
+	PendingPresentCycles = 0;
+}
+
+void FOffAxisLatencyTracker::AddFrameRow(const FFrameRow& Row)
+{
+	const int32 MaxRows = FMath::Max(0, CVarOffAxisLatencyCsvFrames.GetValueOnRenderThread());
+	if (MaxRows == 0)
+	{
+		return;
+	}
+
+	if (FrameRows.Num() < MaxRows)
+	{
+		FrameRows.Add(Row);
+	}
+	else
+	{
+		FrameRows[NextFrameRow % FrameRows.Num()] = Row;
+	}
+	NextFrameRow = (NextFrameRow + 1) % MaxRows;
+}
+
+void FOffAxisLatencyTracker::DumpCsv(const FString& Filename)
+{
+	check(IsInGameThread());
+
+	// Render thread owned data is only read once all queued frames are through.
+	FlushRenderingCommands();
+
+	const FOffAxisLatencyHistogram* Histograms[] = { &GameThreadHistogram, &RenderThreadHistogram, &PresentHistogram };
+
+	FString HistogramCsv = TEXT("BucketMs");
+	for (const TCHAR* StageName : LatencyStageNames)
+	{
+		HistogramCsv += FString::Printf(TEXT(",%s"), StageName);
+	}
+	HistogramCsv += LINE_TERMINATOR;
+
+	for (int32 Bucket = 0; Bucket <= FOffAxisLatencyHistogram::NumBuckets; ++Bucket)
+	{
+		HistogramCsv += FString::Printf(TEXT("%.1f"), Bucket * FOffAxisLatencyHistogram::BucketWidthMs);
+		for (const FOffAxisLatencyHistogram* Histogram : Histograms)
+		{
+			HistogramCsv += FString::Printf(TEXT(",%u"), Histogram->Buckets[Bucket]);
+		}
+		HistogramCsv += LINE_TERMINATOR;
+	}
+
+	FString FramesCsv = TEXT("Frame");
+	for (const TCHAR* StageName : LatencyStageNames)
+	{
+		FramesCsv += FString::Printf(TEXT(",%sMs"), StageName);
+	}
+	FramesCsv += LINE_TERMINATOR;
+
+	// Oldest row first once the ring buffer has wrapped.
+	const int32 FirstRow = FrameRows.Num() ? NextFrameRow % FrameRows.Num() : 0;
+	for (int32 Index = 0; Index < FrameRows.Num(); ++Index)
+	{
+		const FFrameRow& Row = FrameRows[(FirstRow + Index) % FrameRows.Num()];
+		FramesCsv += FString::Printf(TEXT("%u"), Row.FrameNumber);
+		for (float AgeMs : Row.AgeMs)
+		{
+			FramesCsv += FString::Printf(TEXT(",%.3f"), AgeMs);
+		}
+		FramesCsv += LINE_TERMINATOR;
+	}
+
+	const FString HistogramFilename = FPaths::Combine(FPaths::GetPath(Filename), FPaths::GetBaseFilename(Filename) + TEXT("_Histogram.csv"));
+
+	if (FFileHelper::SaveStringToFile(FramesCsv, *Filename) && FFileHelper::SaveStringToFile(HistogramCsv, *HistogramFilename))
+	{
+		UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis latency written to %s and %s"), *Filename, *HistogramFilename);
+	}
+	else
+	{
+		UE_LOG(LogConsoleResponse, Warning, TEXT("Could not write OffAxis latency to %s"), *Filename);
+	}
+}
+
+void FOffAxisLatencyTracker::LogSummary()
+{
+	check(IsInGameThread());
+
+	FlushRenderingCommands();
+
+	const FOffAxisLatencyHistogram* Histograms[] = { &GameThreadHistogram, &RenderThreadHistogram, &PresentHistogram };
+	for (int32 Stage = 0; Stage < (int32)EOffAxisLatencyStage::Num; ++Stage)
+	{
+		const FOffAxisLatencyHistogram& Histogram = *Histograms[Stage];
+		UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis sample -> %s: %u frames, mean %.2f ms, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.2f ms"),
+			LatencyStageNames[Stage], Histogram.Count, Histogram.GetMean(),
+			Histogram.GetPercentile(0.5f), Histogram.GetPercentile(0.95f), Histogram.GetPercentile(0.99f), Histogram.MaxMs);
+	}
+}
+
+void FOffAxisLatencyTracker::Reset()
+{
+	check(IsInGameThread());
+
+	FlushRenderingCommands();
+
+	GameThreadHistogram.Reset();
+	RenderThreadHistogram.Reset();
+	PresentHistogram.Reset();
+	FrameRows.Reset();
+	NextFrameRow = 0;
+	PendingPresentCycles = 0;
+}
+
+static void DumpOffAxisLatencyCsv(const TArray<FString>& Args)
+{
+	const FString Filename = Args.Num() > 0 ? Args[0] : FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("OffAxis"), TEXT("Latency.csv"));
+	FOffAxisLatencyTracker::Get().DumpCsv(Filename);
+}
+
+static FAutoConsoleCommand OffAxisLatencyDumpCsvCmd(
+	TEXT("OffAxis.Latency.DumpCsv"),
+	TEXT("Writes the eye sample age histograms and per-frame ages to a CSV file.\n")
+	TEXT("Usage: OffAxis.Latency.DumpCsv [Filename]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&DumpOffAxisLatencyCsv));
+
+static FAutoConsoleCommand OffAxisLatencySummaryCmd(
+	TEXT("OffAxis.Latency.Summary"),
+	TEXT("Logs mean, percentiles and maximum eye sample age per pipeline stage."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisLatencyTracker::Get().LogSummary(); }));
+
+static FAutoConsoleCommand OffAxisLatencyResetCmd(
+	TEXT("OffAxis.Latency.Reset"),
+	TEXT("Clears the eye sample age histograms and per-frame ages."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisLatencyTracker::Get().Reset(); }));
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "RHI.h"
+
+DECLARE_STATS_GROUP(TEXT("OffAxis"), STATGROUP_OffAxis, STATCAT_Advanced);
+
+/**
+ * Points of the off-axis pipeline at which the age of the eye sample is measured.
+ */
+enum class EOffAxisLatencyStage : uint8
+{
+	GameThread,
+	RenderThread,
+	Present,
+	Num
+};
+
+/**
+ * Fixed bucket histogram of sample ages in milliseconds.
+ */
+struct FOffAxisLatencyHistogram
+{
+	static const int32 NumBuckets = 100;
+	static const float BucketWidthMs;
+
+	uint32	Buckets[NumBuckets + 1];	// last bucket collects everything above the range
+	uint32	Count;
+	double	SumMs;
+	float	MaxMs;
+
+	FOffAxisLatencyHistogram() { Reset(); }
+
+	void Reset();
+	void Add(float AgeMs);
+	float GetPercentile(float Percentile) const;
+	float GetMean() const { return Count ? (float)(SumMs / Count) : 0.0f; }
+};
+
+/**
+ * Measures how old the eye sample used for a frame is when it passes the game thread, the render thread and present.
+ * The game thread stage is fed from UOffAxisGameViewportClient::Draw, the remaining stages are recorded on the render thread.
+ */
+class OFFAXISTEST_API FOffAxisLatencyTracker
+{
+public:
+
+	static FOffAxisLatencyTracker& Get();
+
+	/** Records the game thread age of the sample and carries its timestamp to the render thread and present. */
+	void TrackFrame(uint64 SampleCycles, uint32 FrameNumber);
+
+	/** Writes the histograms and the recorded per-frame rows into a CSV file. Game thread only. */
+	void DumpCsv(const FString& Filename);
+
+	/** Logs mean, percentiles and maximum per stage. Game thread only. */
+	void LogSummary();
+
+	void Reset();
+
+private:
+
+	struct FFrameRow
+	{
+		uint32	FrameNumber;
+		float	AgeMs[(int32)EOffAxisLatencyStage::Num];
+	};
+
+	FOffAxisLatencyTracker();
+
+	void RegisterPresentHook();
+	void OnBackBufferReadyToPresent(class SWindow& Window, const FTexture2DRHIRef& BackBuffer);
+
+	void RecordRenderThread(uint64 SampleCycles, uint32 FrameNumber, float GameThreadAgeMs);
+	void AddFrameRow(const FFrameRow& Row);
+
+	static float CyclesToMs(uint64 SampleCycles);
+
+	/** Written on the game thread only. */
+	FOffAxisLatencyHistogram GameThreadHistogram;
+
+	/** Written on the render thread only. */
+	FOffAxisLatencyHistogram RenderThreadHistogram;
+	FOffAxisLatencyHistogram PresentHistogram;
+	TArray<FFrameRow> FrameRows;
+	int32 NextFrameRow;
+	FFrameRow PendingPresentRow;
+	uint64 PendingPresentCycles;
+
+	bool bPresentHookRegistered;
+};
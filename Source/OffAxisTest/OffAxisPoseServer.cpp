@@ -0,0 +1,367 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "OffAxisTest.h"
+#include "OffAxisPoseServer.h"
+#include "OffAxisGameViewportClient.h"
+#include "OffAxisSequenceRenderer.h"
+
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/CoreDelegates.h"
+
+static TAutoConsoleVariable<int32> CVarOffAxisPoseServerRead(
+	TEXT("r.OffAxis.PoseServer.Read"),
+	0,
+	TEXT("Whether the off-axis views take the eye position from the shared memory pose server.\n")
+	TEXT(" 0: off, use SetOffAxisEyePosition of this instance (default)\n")
+	TEXT(" 1: read the pose published by OffAxis.PoseServer.Start or OffAxis.PoseServer.Replay in any local instance"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisPoseServerSmoothingMs(
+	TEXT("r.OffAxis.PoseServer.SmoothingMs"),
+	8.0f,
+	TEXT("Time constant in milliseconds of the exponential smoothing applied to the eye position before it is published. 0: publish unfiltered"),
+	ECVF_Default);
+
+static const TCHAR* PoseSegmentName = TEXT("OffAxisTrackerPose");
+static const uint32 PoseSegmentMagic = 0x4F415053; // 'OAPS'
+static const uint32 PoseSegmentVersion = 1;
+
+/** Torn reads a reader retries before it keeps the previous pose for this frame. */
+static const int32 MaxReadAttempts = 8;
+
+/** Seconds between attempts to open a segment that does not exist yet. */
+static const double ReopenIntervalSeconds = 1.0;
+
+/**
+ * Publishes a recorded eye trajectory at a fixed rate, standing in for the tracker.
+ */
+class FOffAxisPoseReplay : public FRunnable
+{
+public:
+
+	FOffAxisPoseReplay(const FOffAxisEyeTrajectory& InTrajectory, float InHz, const FOffAxisEyeSample& InScreen)
+		: Trajectory(InTrajectory)
+		, Hz(InHz)
+		, Screen(InScreen)
+	{
+		Thread = FRunnableThread::Create(this, TEXT("OffAxisPoseReplay"), 0, TPri_AboveNormal);
+	}
+
+	virtual ~FOffAxisPoseReplay()
+	{
+		if (Thread)
+		{
+			Thread->Kill(true);
+			delete Thread;
+		}
+	}
+
+	virtual uint32 Run() override
+	{
+		const double StartSeconds = FPlatformTime::Seconds();
+		const double Period = 1.0 / Hz;
+		const float Duration = Trajectory.GetDuration();
+
+		for (uint64 Tick = 0; StopCounter.GetValue() == 0; ++Tick)
+		{
+			const double Elapsed = FPlatformTime::Seconds() - StartSeconds;
+
+			FOffAxisEyeSample Sample = Screen;
+			Sample.EyeRelativePosition = Trajectory.Evaluate(Trajectory.GetStartTime() + (Duration > 0.0f ? FMath::Fmod((float)Elapsed, Duration) : 0.0f));
+			Sample.SampleCycles = FPlatformTime::Cycles64();
+			FOffAxisPoseServer::Get().Publish(Sample);
+
+			const double SleepSeconds = StartSeconds + (Tick + 1) * Period - FPlatformTime::Seconds();
+			if (SleepSeconds > 0.0)
+			{
+				FPlatformProcess::SleepNoStats((float)SleepSeconds);
+			}
+		}
+		return 0;
+	}
+
+	virtual void Stop() override
+	{
+		StopCounter.Increment();
+	}
+
+private:
+
+	FOffAxisEyeTrajectory Trajectory;
+	float Hz;
+	FOffAxisEyeSample Screen;
+	FThreadSafeCounter StopCounter;
+	FRunnableThread* Thread;
+};
+
+FOffAxisPoseServer& FOffAxisPoseServer::Get()
+{
+	static FOffAxisPoseServer Server;
+	return Server;
+}
+
+FOffAxisPoseServer::FOffAxisPoseServer()
+	: PublisherRegion(nullptr)
+	, PublishedPose(nullptr)
+	, FilteredEye(FVector::ZeroVector)
+	, LastPublishedCycles(0)
+	, Replay(nullptr)
+	, ReaderRegion(nullptr)
+	, LastOpenAttemptSeconds(-ReopenIntervalSeconds)
+	, LastReadFrameId(0)
+	, NumReads(0)
+	, NumTornReads(0)
+	, NumFailedReads(0)
+{
+	// The replay thread and the segment have to go before the engine shuts down.
+	FCoreDelegates::OnPreExit.AddRaw(this, &FOffAxisPoseServer::Stop);
+}
+
+bool FOffAxisPoseServer::StartPublishing()
+{
+	if (PublisherRegion)
+	{
+		return true;
+	}
+
+	PublisherRegion = FPlatformMemory::MapNamedSharedMemoryRegion(PoseSegmentName, true,
+		FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write, sizeof(FOffAxisSharedPose));
+	if (!PublisherRegion)
+	{
+		UE_LOG(LogConsoleResponse, Error, TEXT("OffAxis pose server: could not create the shared memory segment %s"), PoseSegmentName);
+		return false;
+	}
+
+	FOffAxisSharedPose* Pose = (FOffAxisSharedPose*)PublisherRegion->GetAddress();
+	FMemory::Memzero(Pose, sizeof(FOffAxisSharedPose));
+	Pose->Version = PoseSegmentVersion;
+	Pose->PublisherProcessId = FPlatformProcess::GetCurrentProcessId();
+	FPlatformMisc::MemoryBarrier();
+	Pose->Magic = PoseSegmentMagic;
+
+	LastPublishedCycles = 0;
+	PublishedPose = Pose;
+
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis pose server: publishing into %s"), PoseSegmentName);
+	return true;
+}
+
+bool FOffAxisPoseServer::StartReplay(const FString& TrajectoryFilename, float Hz, float ScreenWidth, float ScreenHeight, float NewNear)
+{
+	check(IsInGameThread());
+
+	FOffAxisEyeTrajectory Trajectory;
+	if (!Trajectory.LoadFromFile(TrajectoryFilename))
+	{
+		UE_LOG(LogConsoleResponse, Error, TEXT("OffAxis pose server: could not load an eye trajectory from %s"), *TrajectoryFilename);
+		return false;
+	}
+
+	if (Hz <= 0.0f || !StartPublishing())
+	{
+		return false;
+	}
+
+	delete Replay;
+
+	FOffAxisEyeSample Screen;
+	Screen.ScreenWidth = ScreenWidth;
+	Screen.ScreenHeight = ScreenHeight;
+	Screen.NewNear = NewNear;
+	Replay = new FOffAxisPoseReplay(Trajectory, Hz, Screen);
+
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis pose server: replaying %d samples over %.2f s at %.0f Hz"), Trajectory.Times.Num(), Trajectory.GetDuration(), Hz);
+	return true;
+}
+
+void FOffAxisPoseServer::Stop()
+{
+	delete Replay;
+	Replay = nullptr;
+
+	{
+		FScopeLock Lock(&PublishLock);
+		if (PublisherRegion)
+		{
+			FPlatformMemory::UnmapNamedSharedMemoryRegion(PublisherRegion);
+			PublisherRegion = nullptr;
+			PublishedPose = nullptr;
+		}
+	}
+
+	if (ReaderRegion)
+	{
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(ReaderRegion);
+		ReaderRegion = nullptr;
+	}
+}
+
+void FOffAxisPoseServer::Publish(const FOffAxisEyeSample& Sample)
+{
+	FScopeLock Lock(&PublishLock);
+
+	FOffAxisSharedPose* Pose = PublishedPose;
+	if (!Pose)
+	{
+		return;
+	}
+
+	// Exponential smoothing with a fixed time constant, independent of the tracker rate. Restarts after tracking gaps.
+	const float SmoothingSeconds = CVarOffAxisPoseServerSmoothingMs.GetValueOnAnyThread() * 0.001f;
+	const float DeltaSeconds = LastPublishedCycles ? (float)FPlatformTime::ToSeconds64(Sample.SampleCycles - LastPublishedCycles) : 0.0f;
+	if (SmoothingSeconds <= 0.0f || LastPublishedCycles == 0 || DeltaSeconds <= 0.0f || DeltaSeconds > 0.25f)
+	{
+		FilteredEye = Sample.EyeRelativePosition;
+	}
+	else
+	{
+		FilteredEye = FMath::Lerp(FilteredEye, Sample.EyeRelativePosition, 1.0f - FMath::Exp(-DeltaSeconds / SmoothingSeconds));
+	}
+	LastPublishedCycles = Sample.SampleCycles;
+
+	FPlatformAtomics::InterlockedIncrement(&Pose->Sequence);
+
+	Pose->FrameId++;
+	Pose->SampleCycles = Sample.SampleCycles;
+	Pose->ScreenWidth = Sample.ScreenWidth;
+	Pose->ScreenHeight = Sample.ScreenHeight;
+	Pose->NewNear = Sample.NewNear;
+	Pose->EyeX = FilteredEye.X;
+	Pose->EyeY = FilteredEye.Y;
+	Pose->EyeZ = FilteredEye.Z;
+
+	FPlatformAtomics::InterlockedIncrement(&Pose->Sequence);
+}
+
+bool FOffAxisPoseServer::IsReading() const
+{
+	return CVarOffAxisPoseServerRead.GetValueOnAnyThread() != 0;
+}
+
+bool FOffAxisPoseServer::ReadPose(FOffAxisEyeSample& OutSample)
+{
+	check(IsInGameThread());
+
+	if (!IsReading())
+	{
+		return false;
+	}
+
+	if (!ReaderRegion)
+	{
+		const double Now = FPlatformTime::Seconds();
+		if (Now - LastOpenAttemptSeconds < ReopenIntervalSeconds)
+		{
+			return false;
+		}
+		LastOpenAttemptSeconds = Now;
+
+		ReaderRegion = FPlatformMemory::MapNamedSharedMemoryRegion(PoseSegmentName, false, FPlatformMemory::ESharedMemoryAccess::Read, sizeof(FOffAxisSharedPose));
+		if (!ReaderRegion)
+		{
+			return false;
+		}
+	}
+
+	FOffAxisSharedPose* Pose = (FOffAxisSharedPose*)ReaderRegion->GetAddress();
+	if (Pose->Magic != PoseSegmentMagic || Pose->Version != PoseSegmentVersion)
+	{
+		return false;
+	}
+
+	for (int32 Attempt = 0; Attempt < MaxReadAttempts; ++Attempt)
+	{
+		// The segment is mapped read only, so the sequence is read plainly and fenced against the copy.
+		const int32 SequenceBefore = Pose->Sequence;
+		FPlatformMisc::MemoryBarrier();
+		if (SequenceBefore & 1)
+		{
+			NumTornReads++;
+			FPlatformProcess::Yield();
+			continue;
+		}
+
+		FOffAxisSharedPose Copy;
+		FMemory::Memcpy(&Copy, Pose, sizeof(FOffAxisSharedPose));
+
+		FPlatformMisc::MemoryBarrier();
+		if (Pose->Sequence != SequenceBefore)
+		{
+			NumTornReads++;
+			continue;
+		}
+
+		NumReads++;
+		if (Copy.FrameId == 0 || Copy.FrameId == LastReadFrameId)
+		{
+			return false;
+		}
+		LastReadFrameId = Copy.FrameId;
+
+		OutSample.ScreenWidth = Copy.ScreenWidth;
+		OutSample.ScreenHeight = Copy.ScreenHeight;
+		OutSample.NewNear = Copy.NewNear;
+		OutSample.EyeRelativePosition = FVector(Copy.EyeX, Copy.EyeY, Copy.EyeZ);
+		OutSample.SampleCycles = Copy.SampleCycles;
+		return true;
+	}
+
+	NumFailedReads++;
+	return false;
+}
+
+void FOffAxisPoseServer::LogStatus() const
+{
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis pose server: %s%s, reading %s"),
+		IsPublishing() ? TEXT("publishing") : TEXT("not publishing"),
+		IsReplaying() ? TEXT(" a replay") : TEXT(""),
+		CVarOffAxisPoseServerRead.GetValueOnGameThread() ? (ReaderRegion ? TEXT("connected") : TEXT("waiting for a publisher")) : TEXT("off"));
+
+	if (ReaderRegion)
+	{
+		const FOffAxisSharedPose* Pose = (const FOffAxisSharedPose*)ReaderRegion->GetAddress();
+		UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis pose server: publisher process %u, pose %llu, last read %llu, %.1f ms old"),
+			Pose->PublisherProcessId, Pose->FrameId, LastReadFrameId,
+			Pose->SampleCycles ? FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Pose->SampleCycles) : 0.0);
+		UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis pose server: %llu reads, %llu torn and retried, %llu given up"), NumReads, NumTornReads, NumFailedReads);
+	}
+}
+
+static void ReplayOffAxisPoses(const TArray<FString>& Args)
+{
+	if (Args.Num() < 1)
+	{
+		UE_LOG(LogConsoleResponse, Warning, TEXT("Usage: OffAxis.PoseServer.Replay <Trajectory.csv> [Hz] [ScreenWidth] [ScreenHeight] [NewNear]"));
+		return;
+	}
+
+	const float Hz = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 120.0f;
+	const float ScreenWidth = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 52.0f;
+	const float ScreenHeight = Args.Num() > 3 ? FCString::Atof(*Args[3]) : 32.5f;
+	const float NewNear = Args.Num() > 4 ? FCString::Atof(*Args[4]) : 10.0f;
+
+	FOffAxisPoseServer::Get().StartReplay(Args[0], Hz, ScreenWidth, ScreenHeight, NewNear);
+}
+
+static FAutoConsoleCommand OffAxisPoseServerStartCmd(
+	TEXT("OffAxis.PoseServer.Start"),
+	TEXT("Publishes the eye positions handed to SetOffAxisEyePosition in this instance to all local instances."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisPoseServer::Get().StartPublishing(); }));
+
+static FAutoConsoleCommand OffAxisPoseServerReplayCmd(
+	TEXT("OffAxis.PoseServer.Replay"),
+	TEXT("Publishes a recorded eye trajectory (CSV rows of Time,X,Y,Z) in a loop, in place of the tracker.\n")
+	TEXT("Usage: OffAxis.PoseServer.Replay <Trajectory.csv> [Hz] [ScreenWidth] [ScreenHeight] [NewNear]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&ReplayOffAxisPoses));
+
+static FAutoConsoleCommand OffAxisPoseServerStopCmd(
+	TEXT("OffAxis.PoseServer.Stop"),
+	TEXT("Stops publishing and replaying poses and releases the shared memory segment."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisPoseServer::Get().Stop(); }));
+
+static FAutoConsoleCommand OffAxisPoseServerStatusCmd(
+	TEXT("OffAxis.PoseServer.Status"),
+	TEXT("Logs whether this instance publishes or reads poses, the age of the latest pose and the torn read counts."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisPoseServer::Get().LogStatus(); }));
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+
+struct FOffAxisEyeSample;
+class FOffAxisPoseReplay;
+
+/**
+ * Layout of the shared memory segment the pose server publishes into. Guarded by a seqlock: the publisher makes the
+ * sequence odd, writes the pose and makes it even again, readers retry while the sequence is odd or changed under them.
+ */
+struct FOffAxisSharedPose
+{
+	uint32			Magic;
+	uint32			Version;
+
+	/** Odd while the publisher writes. */
+	volatile int32	Sequence;
+	uint32			PublisherProcessId;
+
+	/** Incremented for every published pose. */
+	uint64			FrameId;
+
+	/** FPlatformTime::Cycles64() of the tracker sample, comparable between processes on the same machine. */
+	uint64			SampleCycles;
+
+	float			ScreenWidth;
+	float			ScreenHeight;
+	float			NewNear;
+	float			EyeX;
+	float			EyeY;
+	float			EyeZ;
+};
+
+/**
+ * Shares the filtered tracker pose between engine instances on one machine. The instance connected to the tracker (or a
+ * replay of a recorded trajectory) publishes every sample, any number of instances read the latest pose from the
+ * segment once per frame without locks and without waiting for the publisher.
+ */
+class OFFAXISTEST_API FOffAxisPoseServer
+{
+public:
+
+	static FOffAxisPoseServer& Get();
+
+	/** Creates the segment and publishes the samples handed to SetOffAxisEyePosition from now on. */
+	bool StartPublishing();
+
+	/** Publishes a recorded eye trajectory at Hz samples per second on its own thread, looping, instead of the tracker. */
+	bool StartReplay(const FString& TrajectoryFilename, float Hz, float ScreenWidth, float ScreenHeight, float NewNear);
+
+	void Stop();
+
+	bool IsPublishing() const { return PublishedPose != nullptr; }
+	bool IsReplaying() const { return Replay != nullptr; }
+
+	/** Whether the views take their eye from the segment (r.OffAxis.PoseServer.Read), local samples are then only published. */
+	bool IsReading() const;
+
+	/** Filters the sample and publishes it. May be called from any thread while publishing. */
+	void Publish(const FOffAxisEyeSample& Sample);
+
+	/**
+	 * Copies the latest published pose if r.OffAxis.PoseServer.Read is set and a pose newer than the last one read is
+	 * available. Gives up after a few torn reads rather than waiting for the publisher. Game thread only.
+	 */
+	bool ReadPose(FOffAxisEyeSample& OutSample);
+
+	void LogStatus() const;
+
+private:
+
+	FOffAxisPoseServer();
+
+	/** Publisher side. */
+	FPlatformMemory::FSharedMemoryRegion*	PublisherRegion;
+	FOffAxisSharedPose*						PublishedPose;
+	FCriticalSection						PublishLock;
+	FVector									FilteredEye;
+	uint64									LastPublishedCycles;
+	FOffAxisPoseReplay*						Replay;
+
+	/** Reader side, game thread. */
+	FPlatformMemory::FSharedMemoryRegion*	ReaderRegion;
+	double									LastOpenAttemptSeconds;
+	uint64									LastReadFrameId;
+	uint64									NumReads;
+	uint64									NumTornReads;
+	uint64									NumFailedReads;
+};
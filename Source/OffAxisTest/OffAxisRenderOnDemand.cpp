@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "OffAxisTest.h"
+#include "OffAxisRenderOnDemand.h"
+#include "OffAxisLatencyTracker.h"
+
+#include "Components/LightComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "RenderingThread.h"
+#include "SceneView.h"
+#include "UnrealClient.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Render on demand: scene skipped"), STAT_OffAxisRenderOnDemandSkipped, STATGROUP_OffAxis);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Render on demand: GPU time saved (ms)"), STAT_OffAxisRenderOnDemandSavedMs, STATGROUP_OffAxis);
+
+static TAutoConsoleVariable<int32> CVarOffAxisRenderOnDemand(
+	TEXT("r.OffAxis.RenderOnDemand"),
+	0,
+	TEXT("Whether the scene is only rendered when the views or the scene changed.\n")
+	TEXT(" 0: render every frame (default)\n")
+	TEXT(" 1: re-present the last scene image while nothing changes, see OffAxis.RenderOnDemand.Summary"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarOffAxisRenderOnDemandPixelThreshold(
+	TEXT("r.OffAxis.RenderOnDemand.PixelThreshold"),
+	0.25f,
+	TEXT("Distance in pixels any point of a view may move on screen, through eye, camera or projection changes, from where the last\n")
+	TEXT("scene image showed it before the scene is rendered again."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarOffAxisRenderOnDemandSettleFrames(
+	TEXT("r.OffAxis.RenderOnDemand.SettleFrames"),
+	8,
+	TEXT("Unchanged frames that are still rendered before the image is kept, so temporal effects converge first."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarOffAxisRenderOnDemandMaxIdleFrames(
+	TEXT("r.OffAxis.RenderOnDemand.MaxIdleFrames"),
+	300,
+	TEXT("Frames after which the scene is rendered once even if nothing changed, for changes that aren't detected (e.g. animated materials).\n")
+	TEXT("0: never"),
+	ECVF_Default);
+
+/** Relative change of the near clipping distance that counts as a change, it moves no pixel but clips differently. */
+static const float NearClippingTolerance = 0.01f;
+
+/** Weight of a new frame in the average GPU time of rendered frames. */
+static const double GPUTimeSmoothing = 0.05;
+
+static uint32 HashTransform(uint32 Hash, const FTransform& Transform)
+{
+	const FMatrix Matrix = Transform.ToMatrixWithScale();
+	return FCrc::MemCrc32(&Matrix, sizeof(FMatrix), Hash);
+}
+
+/**
+ * Largest distance in pixels a point of View moves on screen from where RenderedViewProjection showed it, sampled at the
+ * corners and the centre of the view from the near plane out. Covers everything that changes the final view and
+ * projection: the eye, the camera, the off-axis method and the screen near plane.
+ */
+static float GetMaxPixelShift(const FSceneView* View, const FMatrix& RenderedViewProjection)
+{
+	const FMatrix ClipToRenderedClip = View->ViewMatrices.GetInvViewProjectionMatrix() * RenderedViewProjection;
+	const FVector2D HalfSize(View->UnscaledViewRect.Width() * 0.5f, View->UnscaledViewRect.Height() * 0.5f);
+
+	const FVector2D SamplePoints[] = { FVector2D(-1.0f, -1.0f), FVector2D(1.0f, -1.0f), FVector2D(-1.0f, 1.0f), FVector2D(1.0f, 1.0f), FVector2D(0.0f, 0.0f) };
+	const float SampleDepths[] = { 1.0f, 0.5f, 0.1f, 0.01f, 0.001f };
+
+	float MaxShift = 0.0f;
+	for (float DeviceZ : SampleDepths)
+	{
+		for (const FVector2D& Point : SamplePoints)
+		{
+			const FVector4 Clip = ClipToRenderedClip.TransformFVector4(FVector4(Point.X, Point.Y, DeviceZ, 1.0f));
+			if (Clip.W <= SMALL_NUMBER)
+			{
+				return MAX_flt;
+			}
+
+			const FVector2D Shift((Clip.X / Clip.W - Point.X) * HalfSize.X, (Clip.Y / Clip.W - Point.Y) * HalfSize.Y);
+			MaxShift = FMath::Max(MaxShift, Shift.Size());
+		}
+	}
+	return MaxShift;
+}
+
+FOffAxisRenderOnDemand& FOffAxisRenderOnDemand::Get()
+{
+	static FOffAxisRenderOnDemand RenderOnDemand;
+	return RenderOnDemand;
+}
+
+FOffAxisRenderOnDemand::FOffAxisRenderOnDemand()
+	: RenderedViewportSize(FIntPoint::ZeroValue)
+	, RenderedSceneHash(0)
+	, SettledFrames(0)
+	, FramesSinceRender(0)
+	, bHasCachedFrame(false)
+	, bRenderedLastFrame(false)
+	, NumRenderedFrames(0)
+	, NumSkippedFrames(0)
+	, AverageGPUFrameMs(0.0)
+{
+}
+
+bool FOffAxisRenderOnDemand::GetSceneState(UWorld* World, uint32& OutHash)
+{
+	uint32 Hash = 0;
+
+	// Only the actors of this world's visible levels can change its image.
+	TInlineComponentArray<USceneComponent*> Components;
+	for (const ULevel* Level : World->GetLevels())
+	{
+		if (!Level || !Level->bIsVisible)
+		{
+			continue;
+		}
+
+		for (const AActor* Actor : Level->Actors)
+		{
+			if (!Actor)
+			{
+				continue;
+			}
+
+			Actor->GetComponents(Components);
+			for (const USceneComponent* Component : Components)
+			{
+				if (const UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component))
+				{
+					if (!Primitive->SceneProxy)
+					{
+						continue;
+					}
+
+					// Particles and skeletal animation change the image without moving their component.
+					const UParticleSystemComponent* Particles = Cast<UParticleSystemComponent>(Primitive);
+					if (Particles && Particles->IsActive())
+					{
+						return false;
+					}
+
+					const USkeletalMeshComponent* SkeletalMesh = Cast<USkeletalMeshComponent>(Primitive);
+					if (SkeletalMesh && !SkeletalMesh->bPauseAnims && (SkeletalMesh->IsPlaying() || SkeletalMesh->GetAnimInstance()))
+					{
+						return false;
+					}
+
+					if (Primitive->Mobility == EComponentMobility::Movable)
+					{
+						Hash = HashCombine(Hash, Primitive->ComponentId.PrimIDValue);
+						Hash = HashTransform(Hash, Primitive->GetComponentTransform());
+					}
+				}
+				else if (const ULightComponent* Light = Cast<ULightComponent>(Component))
+				{
+					if (Light->Mobility != EComponentMobility::Static)
+					{
+						Hash = HashTransform(Hash, Light->GetComponentTransform());
+						Hash = HashCombine(Hash, GetTypeHash(Light->ComputeLightBrightness()));
+						Hash = HashCombine(Hash, GetTypeHash(Light->LightColor));
+						Hash = HashCombine(Hash, Light->IsVisible());
+					}
+				}
+			}
+		}
+	}
+
+	OutHash = Hash;
+	return true;
+}
+
+bool FOffAxisRenderOnDemand::ShouldRenderScene(UWorld* World, FViewport* Viewport, const FSceneViewFamily& ViewFamily)
+{
+	check(IsInGameThread());
+
+	if (CVarOffAxisRenderOnDemand.GetValueOnGameThread() == 0)
+	{
+		if (bHasCachedFrame)
+		{
+			ReleaseCachedFrame();
+		}
+		SettledFrames = 0;
+		bRenderedLastFrame = false;
+		return true;
+	}
+
+	uint32 SceneHash = 0;
+	const bool bSceneStatic = GetSceneState(World, SceneHash);
+
+	bool bIdle = bSceneStatic
+		&& SceneHash == RenderedSceneHash
+		&& Viewport->GetSizeXY() == RenderedViewportSize
+		&& ViewFamily.Views.Num() == RenderedViewProjections.Num();
+
+	// The final off-axis view and projection, not the tracker input, so matrices set directly are compared as well.
+	const float PixelThreshold = CVarOffAxisRenderOnDemandPixelThreshold.GetValueOnGameThread();
+	for (int32 ViewIndex = 0; ViewIndex < ViewFamily.Views.Num() && bIdle; ++ViewIndex)
+	{
+		const FSceneView* View = ViewFamily.Views[ViewIndex];
+		bIdle = View->UnscaledViewRect == RenderedViewRects[ViewIndex]
+			&& FMath::Abs(View->NearClippingDistance - RenderedNearClippingDistances[ViewIndex]) <= NearClippingTolerance * RenderedNearClippingDistances[ViewIndex]
+			&& GetMaxPixelShift(View, RenderedViewProjections[ViewIndex]) <= PixelThreshold;
+	}
+
+	const int32 MaxIdleFrames = CVarOffAxisRenderOnDemandMaxIdleFrames.GetValueOnGameThread();
+	const bool bSkip = bIdle
+		&& bHasCachedFrame
+		&& SettledFrames >= CVarOffAxisRenderOnDemandSettleFrames.GetValueOnGameThread()
+		&& (MaxIdleFrames <= 0 || FramesSinceRender < MaxIdleFrames);
+
+	if (bSkip)
+	{
+		FramesSinceRender++;
+		NumSkippedFrames++;
+		bRenderedLastFrame = false;
+
+		SET_DWORD_STAT(STAT_OffAxisRenderOnDemandSkipped, 1);
+		SET_FLOAT_STAT(STAT_OffAxisRenderOnDemandSavedMs, (float)AverageGPUFrameMs);
+		return false;
+	}
+
+	// GGPUFrameTime trails the game thread, only average it over runs of rendered frames.
+	if (bRenderedLastFrame && GGPUFrameTime)
+	{
+		const double GPUFrameMs = FPlatformTime::ToMilliseconds(GGPUFrameTime);
+		AverageGPUFrameMs = AverageGPUFrameMs == 0.0 ? GPUFrameMs : AverageGPUFrameMs + (GPUFrameMs - AverageGPUFrameMs) * GPUTimeSmoothing;
+	}
+
+	SettledFrames = bIdle ? SettledFrames + 1 : 0;
+	FramesSinceRender = 0;
+	NumRenderedFrames++;
+	bRenderedLastFrame = true;
+
+	RenderedViewProjections.Reset();
+	RenderedNearClippingDistances.Reset();
+	RenderedViewRects.Reset();
+	for (const FSceneView* View : ViewFamily.Views)
+	{
+		RenderedViewProjections.Add(View->ViewMatrices.GetViewProjectionMatrix());
+		RenderedNearClippingDistances.Add(View->NearClippingDistance);
+		RenderedViewRects.Add(View->UnscaledViewRect);
+	}
+	RenderedViewportSize = Viewport->GetSizeXY();
+
+	// An animated scene never matches, so the hash of the last static frame is kept.
+	RenderedSceneHash = bSceneStatic ? SceneHash : RenderedSceneHash + 1;
+
+	SET_DWORD_STAT(STAT_OffAxisRenderOnDemandSkipped, 0);
+	SET_FLOAT_STAT(STAT_OffAxisRenderOnDemandSavedMs, 0.0f);
+	return true;
+}
+
+void FOffAxisRenderOnDemand::CaptureFrame(FViewport* Viewport)
+{
+	check(IsInGameThread());
+
+	if (CVarOffAxisRenderOnDemand.GetValueOnGameThread() == 0)
+	{
+		return;
+	}
+
+	FOffAxisRenderOnDemand* RenderOnDemand = this;
+	ENQUEUE_RENDER_COMMAND(OffAxisCaptureSceneFrame)(
+		[RenderOnDemand, Viewport](FRHICommandListImmediate& RHICmdList)
+		{
+			const FTexture2DRHIRef& Target = Viewport->GetRenderTargetTexture();
+			if (!Target.IsValid())
+			{
+				return;
+			}
+
+			FTexture2DRHIRef& CachedFrame = RenderOnDemand->CachedFrame;
+			if (!CachedFrame.IsValid() || CachedFrame->GetSizeX() != Target->GetSizeX() || CachedFrame->GetSizeY() != Target->GetSizeY() || CachedFrame->GetFormat() != Target->GetFormat())
+			{
+				FRHIResourceCreateInfo CreateInfo;
+				CachedFrame = RHICreateTexture2D(Target->GetSizeX(), Target->GetSizeY(), Target->GetFormat(), 1, 1, TexCreate_ShaderResource | TexCreate_RenderTargetable | TexCreate_ResolveTargetable, CreateInfo);
+			}
+
+			RHICmdList.CopyToResolveTarget(Target, CachedFrame, true, FResolveParams());
+		});
+
+	bHasCachedFrame = true;
+}
+
+void FOffAxisRenderOnDemand::RestoreFrame(FViewport* Viewport)
+{
+	check(IsInGameThread() && bHasCachedFrame);
+
+	FOffAxisRenderOnDemand* RenderOnDemand = this;
+	ENQUEUE_RENDER_COMMAND(OffAxisRestoreSceneFrame)(
+		[RenderOnDemand, Viewport](FRHICommandListImmediate& RHICmdList)
+		{
+			const FTexture2DRHIRef& Target = Viewport->GetRenderTargetTexture();
+			const FTexture2DRHIRef& CachedFrame = RenderOnDemand->CachedFrame;
+			if (Target.IsValid() && CachedFrame.IsValid())
+			{
+				RHICmdList.CopyToResolveTarget(CachedFrame, Target, true, FResolveParams());
+			}
+		});
+}
+
+void FOffAxisRenderOnDemand::ReleaseCachedFrame()
+{
+	FOffAxisRenderOnDemand* RenderOnDemand = this;
+	ENQUEUE_RENDER_COMMAND(OffAxisReleaseSceneFrame)(
+		[RenderOnDemand](FRHICommandListImmediate& RHICmdList)
+		{
+			RenderOnDemand->CachedFrame.SafeRelease();
+		});
+
+	bHasCachedFrame = false;
+}
+
+void FOffAxisRenderOnDemand::LogSummary() const
+{
+	const uint64 NumFrames = NumRenderedFrames + NumSkippedFrames;
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis render on demand: skipped the scene in %llu of %llu frames (%.1f%%)"),
+		NumSkippedFrames, NumFrames, NumFrames ? 100.0 * NumSkippedFrames / NumFrames : 0.0);
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis render on demand: %.2f ms GPU per rendered frame, an estimated %.1f s of GPU time saved"),
+		AverageGPUFrameMs, AverageGPUFrameMs * NumSkippedFrames / 1000.0);
+}
+
+void FOffAxisRenderOnDemand::Reset()
+{
+	NumRenderedFrames = 0;
+	NumSkippedFrames = 0;
+}
+
+static FAutoConsoleCommand OffAxisRenderOnDemandSummaryCmd(
+	TEXT("OffAxis.RenderOnDemand.Summary"),
+	TEXT("Logs how many frames re-presented the last scene image and the estimated GPU time saved."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisRenderOnDemand::Get().LogSummary(); }));
+
+static FAutoConsoleCommand OffAxisRenderOnDemandResetCmd(
+	TEXT("OffAxis.RenderOnDemand.Reset"),
+	TEXT("Clears the render on demand statistics."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisRenderOnDemand::Get().Reset(); }));
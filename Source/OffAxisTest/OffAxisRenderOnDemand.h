@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+
+class FSceneViewFamily;
+class FViewport;
+class UWorld;
+
+/**
+ * Re-presents the last rendered scene image instead of rendering the scene again while the final off-axis views move no
+ * point on screen by more than a threshold and nothing in the scene moves, animates or emits particles. Rendering resumes on the first
+ * frame that changes. A copy of the scene image is kept on the GPU after every rendered frame.
+ */
+class OFFAXISTEST_API FOffAxisRenderOnDemand
+{
+public:
+
+	static FOffAxisRenderOnDemand& Get();
+
+	/** Whether the scene of this frame has to be rendered. Call once the view matrices are final. Game thread only. */
+	bool ShouldRenderScene(UWorld* World, FViewport* Viewport, const FSceneViewFamily& ViewFamily);
+
+	/** Keeps a copy of the scene image just rendered into Viewport. Call right after the scene rendering is queued. */
+	void CaptureFrame(FViewport* Viewport);
+
+	/** Copies the last scene image back into Viewport in place of rendering the scene. */
+	void RestoreFrame(FViewport* Viewport);
+
+	/** Logs the skipped frames and the estimated GPU time saved. Game thread only. */
+	void LogSummary() const;
+
+	void Reset();
+
+private:
+
+	FOffAxisRenderOnDemand();
+
+	/** Hash over everything movable in the world that could change the image, false if something animates. */
+	static bool GetSceneState(UWorld* World, uint32& OutHash);
+
+	void ReleaseCachedFrame();
+
+	/** State of the last rendered frame. */
+	TArray<FMatrix>		RenderedViewProjections;
+	TArray<float>		RenderedNearClippingDistances;
+	TArray<FIntRect>	RenderedViewRects;
+	FIntPoint			RenderedViewportSize;
+	uint32				RenderedSceneHash;
+
+	/** Rendered frames in a row that were already idle, the image has to settle (e.g. temporal AA) before it is kept. */
+	int32	SettledFrames;
+	int32	FramesSinceRender;
+	bool	bHasCachedFrame;
+	bool	bRenderedLastFrame;
+
+	/** Render thread only. */
+	FTexture2DRHIRef CachedFrame;
+
+	/** Game thread statistics. */
+	uint64	NumRenderedFrames;
+	uint64	NumSkippedFrames;
+	double	AverageGPUFrameMs;
+};
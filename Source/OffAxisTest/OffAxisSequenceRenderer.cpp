@@ -0,0 +1,387 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "OffAxisTest.h"
+#include "OffAxisSequenceRenderer.h"
+
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Modules/ModuleManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "RenderingThread.h"
+#include "UnrealClient.h"
+
+static TAutoConsoleVariable<int32> CVarOffAxisSequenceEncoderThreads(
+	TEXT("r.OffAxis.Sequence.EncoderThreads"),
+	4,
+	TEXT("Number of worker threads encoding the frames of OffAxis.RenderSequence."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarOffAxisSequenceMaxQueuedFrames(
+	TEXT("r.OffAxis.Sequence.MaxQueuedFrames"),
+	8,
+	TEXT("Number of read back frames that may wait for encoding before the render thread holds back further readbacks."),
+	ECVF_Default);
+
+bool FOffAxisEyeTrajectory::LoadFromFile(const FString& Filename)
+{
+	Times.Reset();
+	Positions.Reset();
+
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *Filename))
+	{
+		return false;
+	}
+
+	for (const FString& Line : Lines)
+	{
+		TArray<FString> Values;
+		Line.ParseIntoArray(Values, TEXT(","));
+
+		// Skips the header and anything else that is not a sample.
+		if (Values.Num() < 4 || !Values[0].TrimStartAndEnd().IsNumeric())
+		{
+			continue;
+		}
+
+		const float Time = FCString::Atof(*Values[0]);
+		if (Times.Num() && Time <= Times.Last())
+		{
+			continue;
+		}
+
+		Times.Add(Time);
+		Positions.Add(FVector(FCString::Atof(*Values[1]), FCString::Atof(*Values[2]), FCString::Atof(*Values[3])));
+	}
+
+	return Times.Num() > 0;
+}
+
+FVector FOffAxisEyeTrajectory::Evaluate(float Time) const
+{
+	check(Times.Num() > 0);
+
+	if (Time <= Times[0])
+	{
+		return Positions[0];
+	}
+	if (Time >= Times.Last())
+	{
+		return Positions.Last();
+	}
+
+	// First sample after Time.
+	int32 Next = 1;
+	int32 Last = Times.Num() - 1;
+	while (Next < Last)
+	{
+		const int32 Middle = (Next + Last) / 2;
+		if (Times[Middle] > Time)
+		{
+			Last = Middle;
+		}
+		else
+		{
+			Next = Middle + 1;
+		}
+	}
+	const float Alpha = (Time - Times[Next - 1]) / (Times[Next] - Times[Next - 1]);
+	return FMath::Lerp(Positions[Next - 1], Positions[Next], Alpha);
+}
+
+/**
+ * Encodes one read back frame and writes it to disk on an encoder thread.
+ */
+class FOffAxisFrameEncodeWork : public IQueuedWork
+{
+public:
+
+	FOffAxisFrameEncodeWork(IImageWrapperModule& InImageWrapperModule, const FString& InFilename, const FIntPoint& InSize, FThreadSafeCounter& InPendingFrames, FThreadSafeCounter& InEncodingFrames)
+		: ImageWrapperModule(InImageWrapperModule)
+		, Filename(InFilename)
+		, Size(InSize)
+		, PendingFrames(InPendingFrames)
+		, EncodingFrames(InEncodingFrames)
+	{
+	}
+
+	TArray<FColor>			Pixels;
+	TArray<FLinearColor>	FloatPixels;
+
+	virtual void DoThreadedWork() override
+	{
+		const bool bExr = FloatPixels.Num() > 0;
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(bExr ? EImageFormat::EXR : EImageFormat::PNG);
+
+		bool bSet = false;
+		if (ImageWrapper.IsValid())
+		{
+			// The back buffer alpha is undefined, write the frame opaque.
+			if (bExr)
+			{
+				// The back buffer holds sRGB encoded output of the tonemapper, EXR expects linear values.
+				for (FLinearColor& Pixel : FloatPixels)
+				{
+					Pixel.R = SRGBToLinear(Pixel.R);
+					Pixel.G = SRGBToLinear(Pixel.G);
+					Pixel.B = SRGBToLinear(Pixel.B);
+					Pixel.A = 1.0f;
+				}
+				bSet = ImageWrapper->SetRaw(FloatPixels.GetData(), FloatPixels.Num() * sizeof(FLinearColor), Size.X, Size.Y, ERGBFormat::RGBA, 32);
+			}
+			else
+			{
+				for (FColor& Pixel : Pixels)
+				{
+					Pixel.A = 255;
+				}
+				bSet = ImageWrapper->SetRaw(Pixels.GetData(), Pixels.Num() * sizeof(FColor), Size.X, Size.Y, ERGBFormat::BGRA, 8);
+			}
+		}
+
+		if (!bSet || !FFileHelper::SaveArrayToFile(ImageWrapper->GetCompressed(), *Filename))
+		{
+			UE_LOG(LogConsoleResponse, Warning, TEXT("OffAxis sequence: could not write %s"), *Filename);
+		}
+
+		Finish();
+	}
+
+	virtual void Abandon() override
+	{
+		Finish();
+	}
+
+private:
+
+	static float SRGBToLinear(float Value)
+	{
+		return Value <= 0.04045f ? Value / 12.92f : FMath::Pow((Value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	void Finish()
+	{
+		EncodingFrames.Decrement();
+		PendingFrames.Decrement();
+		delete this;
+	}
+
+	IImageWrapperModule&	ImageWrapperModule;
+	FString					Filename;
+	FIntPoint				Size;
+	FThreadSafeCounter&		PendingFrames;
+	FThreadSafeCounter&		EncodingFrames;
+};
+
+FOffAxisSequenceRenderer& FOffAxisSequenceRenderer::Get()
+{
+	static FOffAxisSequenceRenderer Renderer;
+	return Renderer;
+}
+
+FOffAxisSequenceRenderer::FOffAxisSequenceRenderer()
+	: FramesPerSecond(30.0f)
+	, bWriteExr(false)
+	, FrameIndex(0)
+	, bRendering(false)
+	, bWasBenchmarking(false)
+	, bWasUsingFixedTimeStep(false)
+	, PreviousFixedDeltaTime(0.0)
+	, EncoderPool(nullptr)
+	, MaxQueuedFrames(0)
+{
+}
+
+bool FOffAxisSequenceRenderer::Start(const FString& TrajectoryFilename, const FString& InOutputDirectory, float InFramesPerSecond, bool bInWriteExr)
+{
+	check(IsInGameThread());
+
+	if (bRendering || EncoderPool)
+	{
+		UE_LOG(LogConsoleResponse, Warning, TEXT("OffAxis sequence: the previous sequence is still being written"));
+		return false;
+	}
+
+	if (!Trajectory.LoadFromFile(TrajectoryFilename))
+	{
+		UE_LOG(LogConsoleResponse, Warning, TEXT("OffAxis sequence: could not load an eye trajectory from %s"), *TrajectoryFilename);
+		return false;
+	}
+
+	OutputDirectory = InOutputDirectory;
+	FramesPerSecond = FMath::Max(InFramesPerSecond, 1.0f);
+	bWriteExr = bInWriteExr;
+	FrameIndex = 0;
+
+	if (!IFileManager::Get().MakeDirectory(*OutputDirectory, true))
+	{
+		UE_LOG(LogConsoleResponse, Warning, TEXT("OffAxis sequence: could not create %s"), *OutputDirectory);
+		return false;
+	}
+
+	// The image wrapper module has to be loaded on the game thread before the encoders use it.
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+	EncoderPool = FQueuedThreadPool::Allocate();
+	if (!EncoderPool->Create(FMath::Max(1, CVarOffAxisSequenceEncoderThreads.GetValueOnGameThread()), 128 * 1024, TPri_BelowNormal))
+	{
+		delete EncoderPool;
+		EncoderPool = nullptr;
+		return false;
+	}
+	MaxQueuedFrames = FMath::Max(1, CVarOffAxisSequenceMaxQueuedFrames.GetValueOnGameThread());
+
+	// Step the world by exactly one frame of the sequence per engine frame, however long rendering and readback take.
+	bWasBenchmarking = FApp::IsBenchmarking();
+	bWasUsingFixedTimeStep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetBenchmarking(true);
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(1.0 / FramesPerSecond);
+
+	bRendering = true;
+
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis sequence: rendering %.2f s at %.2f fps to %s"), Trajectory.GetDuration(), FramesPerSecond, *OutputDirectory);
+	return true;
+}
+
+void FOffAxisSequenceRenderer::Stop()
+{
+	check(IsInGameThread());
+
+	if (!bRendering)
+	{
+		return;
+	}
+
+	FApp::SetBenchmarking(bWasBenchmarking);
+	FApp::SetUseFixedTimeStep(bWasUsingFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+
+	bRendering = false;
+
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis sequence: rendered %d frames, waiting for the encoders"), FrameIndex);
+}
+
+bool FOffAxisSequenceRenderer::GetFrameEyePosition(FVector& OutEyeRelativePosition) const
+{
+	if (!bRendering)
+	{
+		return false;
+	}
+
+	OutEyeRelativePosition = Trajectory.Evaluate(Trajectory.GetStartTime() + FrameIndex / FramesPerSecond);
+	return true;
+}
+
+void FOffAxisSequenceRenderer::CaptureFrame(FViewport* Viewport)
+{
+	check(IsInGameThread());
+
+	if (!bRendering)
+	{
+		return;
+	}
+
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	const FString Filename = FPaths::Combine(OutputDirectory, FString::Printf(TEXT("Frame_%05d.%s"), FrameIndex, bWriteExr ? TEXT("exr") : TEXT("png")));
+	const bool bExr = bWriteExr;
+	FQueuedThreadPool* Pool = EncoderPool;
+	FThreadSafeCounter* Pending = &PendingFrames;
+	FThreadSafeCounter* Encoding = &EncodingFrames;
+	const int32 MaxQueued = MaxQueuedFrames;
+
+	// Counted here already so Tick does not release the encoders while the readback is still in the render command queue.
+	PendingFrames.Increment();
+
+	ENQUEUE_RENDER_COMMAND(OffAxisReadbackSequenceFrame)(
+		[Viewport, Filename, bExr, Pool, Pending, Encoding, MaxQueued, &ImageWrapperModule](FRHICommandListImmediate& RHICmdList)
+		{
+			// Back pressure holds the render thread, and through the frame fence the game thread, until an encoder is free.
+			while (Encoding->GetValue() >= MaxQueued)
+			{
+				FPlatformProcess::Sleep(0.001f);
+			}
+
+			const FTexture2DRHIRef& Texture = Viewport->GetRenderTargetTexture();
+			if (!Texture.IsValid())
+			{
+				Pending->Decrement();
+				return;
+			}
+
+			const FIntPoint Size(Texture->GetSizeX(), Texture->GetSizeY());
+			const FIntRect Rect(FIntPoint::ZeroValue, Size);
+
+			FOffAxisFrameEncodeWork* Work = new FOffAxisFrameEncodeWork(ImageWrapperModule, Filename, Size, *Pending, *Encoding);
+			if (bExr)
+			{
+				// The back buffer is 8 or 10 bit, not FloatRGBA, so it is read through the format converting path.
+				RHICmdList.ReadSurfaceData(Texture, Rect, Work->FloatPixels, FReadSurfaceDataFlags(RCM_MinMax));
+			}
+			else
+			{
+				RHICmdList.ReadSurfaceData(Texture, Rect, Work->Pixels, FReadSurfaceDataFlags());
+			}
+
+			Encoding->Increment();
+			Pool->AddQueuedWork(Work);
+		});
+
+	FrameIndex++;
+
+	if (FrameIndex / FramesPerSecond > Trajectory.GetDuration())
+	{
+		Stop();
+	}
+}
+
+void FOffAxisSequenceRenderer::Tick()
+{
+	check(IsInGameThread());
+
+	if (bRendering || !EncoderPool)
+	{
+		return;
+	}
+
+	if (PendingFrames.GetValue() > 0)
+	{
+		return;
+	}
+
+	EncoderPool->Destroy();
+	delete EncoderPool;
+	EncoderPool = nullptr;
+
+	UE_LOG(LogConsoleResponse, Display, TEXT("OffAxis sequence: %d frames written to %s"), FrameIndex, *OutputDirectory);
+}
+
+static void RenderOffAxisSequence(const TArray<FString>& Args)
+{
+	if (Args.Num() < 1)
+	{
+		UE_LOG(LogConsoleResponse, Warning, TEXT("Usage: OffAxis.RenderSequence <Trajectory.csv> [OutputDirectory] [FramesPerSecond] [png|exr]"));
+		return;
+	}
+
+	const FString OutputDirectory = Args.Num() > 1 ? Args[1] : FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("OffAxis"), TEXT("Sequence"));
+	const float FramesPerSecond = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 30.0f;
+	const bool bWriteExr = Args.Num() > 3 && Args[3] == TEXT("exr");
+
+	FOffAxisSequenceRenderer::Get().Start(Args[0], OutputDirectory, FramesPerSecond, bWriteExr);
+}
+
+static FAutoConsoleCommand OffAxisRenderSequenceCmd(
+	TEXT("OffAxis.RenderSequence"),
+	TEXT("Renders a recorded eye trajectory (CSV rows of Time,X,Y,Z) offline at a fixed timestep into PNG or EXR frames.\n")
+	TEXT("Usage: OffAxis.RenderSequence <Trajectory.csv> [OutputDirectory] [FramesPerSecond] [png|exr]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RenderOffAxisSequence));
+
+static FAutoConsoleCommand OffAxisStopSequenceCmd(
+	TEXT("OffAxis.StopSequence"),
+	TEXT("Stops OffAxis.RenderSequence after the current frame."),
+	FConsoleCommandDelegate::CreateLambda([]() { FOffAxisSequenceRenderer::Get().Stop(); }));
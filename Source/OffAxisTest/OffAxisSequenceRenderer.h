@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+
+class FViewport;
+class FQueuedThreadPool;
+
+/**
+ * Eye positions over time, loaded from a CSV file with one "Time,X,Y,Z" row per sample.
+ */
+struct FOffAxisEyeTrajectory
+{
+	TArray<float>	Times;
+	TArray<FVector>	Positions;
+
+	bool LoadFromFile(const FString& Filename);
+
+	/** Linearly interpolated eye position at Time, clamped to the recorded range. */
+	FVector Evaluate(float Time) const;
+
+	float GetStartTime() const { return Times.Num() ? Times[0] : 0.0f; }
+	float GetDuration() const { return Times.Num() ? Times.Last() - Times[0] : 0.0f; }
+};
+
+/**
+ * Renders a recorded eye trajectory offline: the world is stepped at a fixed timestep, every frame uses the eye position
+ * of the trajectory at that time, and the frames are read back on the render thread and encoded to PNG or EXR by a pool
+ * of worker threads (EXR as 32 bit float, converted back to linear). The number of frames waiting for encoding is bounded: when the encoders fall
+ * behind, the render thread holds back further readbacks and the game thread stalls on the frame fence behind it.
+ */
+class OFFAXISTEST_API FOffAxisSequenceRenderer
+{
+public:
+
+	static FOffAxisSequenceRenderer& Get();
+
+	bool Start(const FString& TrajectoryFilename, const FString& InOutputDirectory, float InFramesPerSecond, bool bInWriteExr);
+	void Stop();
+
+	bool IsRendering() const { return bRendering; }
+
+	/** Eye position for the frame about to be drawn. Returns false while no sequence is rendering. */
+	bool GetFrameEyePosition(FVector& OutEyeRelativePosition) const;
+
+	/** Queues the readback and encoding of the frame just drawn into Viewport and advances to the next frame. */
+	void CaptureFrame(FViewport* Viewport);
+
+	/** Releases the encoder threads once the last frames are written. Game thread, once per frame. */
+	void Tick();
+
+private:
+
+	FOffAxisSequenceRenderer();
+
+	FOffAxisEyeTrajectory Trajectory;
+	FString OutputDirectory;
+	float FramesPerSecond;
+	bool bWriteExr;
+	int32 FrameIndex;
+	bool bRendering;
+
+	/** Restored when the sequence ends. */
+	bool bWasBenchmarking;
+	bool bWasUsingFixedTimeStep;
+	double PreviousFixedDeltaTime;
+
+	FQueuedThreadPool* EncoderPool;
+
+	/** Frames captured but not yet written, counted from the moment the game thread queues their readback. */
+	FThreadSafeCounter PendingFrames;
+
+	/** Frames read back and handed to the encoders, bounded by MaxQueuedFrames on the render thread. */
+	FThreadSafeCounter EncodingFrames;
+	int32 MaxQueuedFrames;
+};
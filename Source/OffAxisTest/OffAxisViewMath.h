@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FSceneViewInitOptions;
+
+/**
+ * The off-axis view math of UOffAxisGameViewportClient, for the automation tests. Implemented next to the viewport client.
+ */
+struct OFFAXISTEST_API FOffAxisViewMath
+{
+	/** 0 for the optimized method, 1 for the basic one, see UOffAxisGameViewportClient::ToggleOffAxisMethod. */
+	static int32 GetMethod();
+	static void SetMethod(int32 Method);
+
+	/** Projection matrix (unadjusted for the RHI) that applies OffAxisMatrix to the camera view calculated by CalcSceneView. */
+	static FMatrix GetOffAxisProjection(const FMatrix& CameraViewMatrix, const FMatrix& OffAxisMatrix);
+
+	/** View and projection re-centred on the eye that render the same image as CameraViewMatrix * OffAxisProjection. */
+	static bool GetEyeViewInitOptions(const FMatrix& CameraViewMatrix, const FMatrix& OffAxisProjection, const FIntRect& ViewRect, FSceneViewInitOptions& OutInitOptions);
+};
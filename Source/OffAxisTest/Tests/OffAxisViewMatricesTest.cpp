@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "OffAxisTest.h"
+#include "OffAxisGameViewportClient.h"
+#include "OffAxisViewMath.h"
+
+#include "Misc/AutomationTest.h"
+#include "SceneView.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** View matrix CalcSceneView builds for a camera at Location looking along Rotation. */
+static FMatrix GetCameraViewMatrix(const FVector& Location, const FRotator& Rotation)
+{
+	return FTranslationMatrix(-Location) * FInverseRotationMatrix(Rotation) * FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+}
+
+static FVector ProjectToNdc(const FVector4& Position, const FMatrix& Matrix)
+{
+	const FVector4 Clip = Matrix.TransformFVector4(Position);
+	return FVector(Clip.X, Clip.Y, Clip.Z) / Clip.W;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOffAxisViewMatricesTest, "OffAxis.ViewMatrices", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+/**
+ * Checks the eye-centred view matrices of both off-axis methods without a viewport or GPU: velocities reconstructed the
+ * way the renderer does it (ClipToPrevClip from the previous frame's matrices) must match the motion of the off-axis
+ * projection itself, and the temporal AA jitter must move every pixel by the same amount at every depth.
+ */
+bool FOffAxisViewMatricesTest::RunTest(const FString& Parameters)
+{
+	const FIntRect ViewRect(0, 0, 1920, 1080);
+	const float ScreenWidth = 52.0f;
+	const float ScreenHeight = 32.5f;
+	const float NewNear = 10.0f;
+
+	// Errors in pixels, one pixel spans 2 / Width of clip space.
+	const float PixelsPerNdc = ViewRect.Width() * 0.5f;
+	const float Tolerance = 0.01f;
+
+	const int32 ActiveMethod = FOffAxisViewMath::GetMethod();
+	for (int32 Version = 0; Version < 2; ++Version)
+	{
+		FOffAxisViewMath::SetMethod(Version);
+		const TCHAR* VersionName = Version ? TEXT("Basic") : TEXT("Optimized");
+
+		// The basic method expects the eye in front of the near plane, the optimized one behind the screen origin.
+		const float EyeSign = Version == 0 ? -1.0f : 1.0f;
+		const FVector EyePositions[2] = { FVector(4.0f, -2.0f, 60.0f * EyeSign), FVector(6.5f, -1.0f, 57.0f * EyeSign) };
+		const FMatrix CameraViewMatrices[2] = {
+			GetCameraViewMatrix(FVector(-3.0f, 1.0f, 120.0f), FRotator(-1.0f, 0.5f, 0.0f)),
+			GetCameraViewMatrix(FVector(0.0f, 0.0f, 120.0f), FRotator(0.0f, 0.0f, 0.0f)) };
+
+		FMatrix OffAxisViewProjections[2];
+		FViewMatrices EyeViewMatrices[2];
+		bool bHasApex = true;
+		for (int32 Frame = 0; Frame < 2; ++Frame)
+		{
+			const FMatrix OffAxisMatrix = UOffAxisGameViewportClient::GenerateOffAxisMatrix(ScreenWidth, ScreenHeight, EyePositions[Frame], NewNear);
+			const FMatrix OffAxisProjection = FOffAxisViewMath::GetOffAxisProjection(CameraViewMatrices[Frame], OffAxisMatrix);
+			OffAxisViewProjections[Frame] = CameraViewMatrices[Frame] * OffAxisProjection;
+
+			FSceneViewInitOptions InitOptions;
+			if (!TestTrue(FString::Printf(TEXT("%s: the off-axis frustum of frame %d has an apex"), VersionName, Frame),
+				FOffAxisViewMath::GetEyeViewInitOptions(CameraViewMatrices[Frame], OffAxisProjection, ViewRect, InitOptions)))
+			{
+				bHasApex = false;
+				break;
+			}
+			EyeViewMatrices[Frame] = FViewMatrices(InitOptions);
+		}
+		if (!bHasApex)
+		{
+			continue;
+		}
+
+		// Half a pixel, as the largest temporal AA sample offsets.
+		const FVector2D Jitter(1.0f / ViewRect.Width(), -1.0f / ViewRect.Height());
+
+		FViewMatrices JitteredEyeViewMatrices = EyeViewMatrices[1];
+		JitteredEyeViewMatrices.HackAddTemporalAAProjectionJitter(Jitter);
+
+		// The same jitter applied to the projection on the camera view, as the renderer used to do it.
+		FMatrix JitteredOffAxisProjection = CameraViewMatrices[1].Inverse() * OffAxisViewProjections[1];
+		JitteredOffAxisProjection.M[2][0] += Jitter.X;
+		JitteredOffAxisProjection.M[2][1] += Jitter.Y;
+		const FMatrix JitteredOffAxisViewProjection = CameraViewMatrices[1] * JitteredOffAxisProjection;
+
+		const FMatrix InvOffAxisViewProjection = OffAxisViewProjections[1].Inverse();
+		const FMatrix ClipToPrevClip = EyeViewMatrices[1].GetInvViewProjectionMatrix() * EyeViewMatrices[0].GetViewProjectionMatrix();
+
+		float MaxPositionError = 0.0f;
+		float MaxVelocityError = 0.0f;
+		float MaxJitterError = 0.0f;
+		float MaxCameraJitterError = 0.0f;
+
+		const float SampleDepths[] = { 0.9f, 0.5f, 0.1f, 0.01f, 0.001f };
+		for (float DeviceZ : SampleDepths)
+		{
+			for (float Y = -0.9f; Y <= 0.91f; Y += 0.45f)
+			{
+				for (float X = -0.9f; X <= 0.91f; X += 0.45f)
+				{
+					// A static world position visible at this pixel and depth in the current frame.
+					const FVector4 Clip = InvOffAxisViewProjection.TransformFVector4(FVector4(X, Y, DeviceZ, 1.0f));
+					const FVector4 WorldPosition(FVector(Clip.X, Clip.Y, Clip.Z) / Clip.W, 1.0f);
+
+					const FVector Ndc = ProjectToNdc(WorldPosition, OffAxisViewProjections[1]);
+					const FVector ExpectedVelocity = Ndc - ProjectToNdc(WorldPosition, OffAxisViewProjections[0]);
+
+					const FVector EyeNdc = ProjectToNdc(WorldPosition, EyeViewMatrices[1].GetViewProjectionMatrix());
+					const FVector PrevEyeNdc = ProjectToNdc(FVector4(EyeNdc, 1.0f), ClipToPrevClip);
+					const FVector Velocity = EyeNdc - PrevEyeNdc;
+
+					const FVector JitterOffset = ProjectToNdc(WorldPosition, JitteredEyeViewMatrices.GetViewProjectionMatrix()) - EyeNdc;
+					const FVector CameraJitterOffset = ProjectToNdc(WorldPosition, JitteredOffAxisViewProjection) - Ndc;
+
+					MaxPositionError = FMath::Max(MaxPositionError, FVector2D(EyeNdc.X - Ndc.X, EyeNdc.Y - Ndc.Y).Size());
+					MaxVelocityError = FMath::Max(MaxVelocityError, FVector2D(Velocity.X - ExpectedVelocity.X, Velocity.Y - ExpectedVelocity.Y).Size());
+					MaxJitterError = FMath::Max(MaxJitterError, FVector2D(JitterOffset.X - Jitter.X, JitterOffset.Y - Jitter.Y).Size());
+					MaxCameraJitterError = FMath::Max(MaxCameraJitterError, FVector2D(CameraJitterOffset.X - Jitter.X, CameraJitterOffset.Y - Jitter.Y).Size());
+				}
+			}
+		}
+
+		AddInfo(FString::Printf(TEXT("%s: max error in pixels: position %.5f, velocity %.5f, jitter %.5f (jitter on the camera view %.5f)"),
+			VersionName, MaxPositionError * PixelsPerNdc, MaxVelocityError * PixelsPerNdc, MaxJitterError * PixelsPerNdc, MaxCameraJitterError * PixelsPerNdc));
+
+		TestTrue(FString::Printf(TEXT("%s: position error below %.3f pixels"), VersionName, Tolerance), MaxPositionError * PixelsPerNdc < Tolerance);
+		TestTrue(FString::Printf(TEXT("%s: velocity error below %.3f pixels"), VersionName, Tolerance), MaxVelocityError * PixelsPerNdc < Tolerance);
+		TestTrue(FString::Printf(TEXT("%s: jitter error below %.3f pixels"), VersionName, Tolerance), MaxJitterError * PixelsPerNdc < Tolerance);
+	}
+	FOffAxisViewMath::SetMethod(ActiveMethod);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS